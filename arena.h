@@ -220,6 +220,10 @@ QUICK USAGE:
         // for debug functionality, you can also do:
         #define ARENA_DEBUG
 
+        // or, for canaries and poisoning that are cheap
+        // enough to leave on in soak tests:
+        #define ARENA_GUARD
+
         // If you would like to change the default alignment for
         // allocations, you can define:
         #define ARENA_DEFAULT_ALIGNMENT <alignment_value>
@@ -234,6 +238,15 @@ QUICK USAGE:
   for C11 or later, but also allows the same
   behavior for C89 and C99
 
+  To let arena_alloc, arena_alloc_aligned and
+  arena_clear be inlined into every translation unit
+  without LTO, define the following before every
+  `#include "arena.h"` in the build, not only in the
+  implementation.
+        ```
+        #define ARENA_INLINE_HOT_PATH
+        ```
+
   After doing that, you can `#include "arena.h"`
   And for any other file in any other translation
   unit in the build, you can `#include "arena.h"`
@@ -251,16 +264,249 @@ QUICK USAGE:
 #if __STDC_VERSION__ >= 201112L
     #include <stdalign.h>
     #define ARENA_ALIGNOF(type) alignof(type)
+#elif defined(__cplusplus) && __cplusplus >= 201103L
+    #define ARENA_ALIGNOF(type) alignof(type)
 #else
     #define ARENA_ALIGNOF(type) offsetof(struct { char c; type d; }, d)
 #endif
 
 
+#if __STDC_VERSION__ >= 201112L && !defined(__STDC_NO_ATOMICS__)
+    #include <stdatomic.h>
+    #define ARENA_HAS_ATOMICS
+#endif
+
+
+/* arena_string_appendf needs vsnprintf, which C89 does not have */
+#if __STDC_VERSION__ >= 199901L || (defined(__cplusplus) && __cplusplus >= 201103L)
+    #define ARENA_HAS_FORMAT
+#endif
+
+
+/*
+Called by arena_clear and arena_destroy with the first overwritten canary of a guarded arena, and by
+arena_clear and arena_rewind with the region of a read-only mapped arena they refused to write to
+*/
+#if defined(ARENA_GUARD) && !defined(ARENA_GUARD_FAIL)
+    #include <stdio.h>
+    #include <stdlib.h>
+    #define ARENA_GUARD_FAIL(arena, pointer)                                         \
+        (fprintf(stderr, "arena %p: canary at %p was overwritten\n", (void *)(arena), \
+                 (pointer)), abort())
+#endif
+
+
+/* The implementation itself must be compiled as C, see arena.hpp */
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+#ifdef ARENA_INLINE_HOT_PATH
+    #if __STDC_VERSION__ >= 199901L || defined(__cplusplus)
+        #define ARENA_INLINE static inline
+    #elif defined(__GNUC__)
+        #define ARENA_INLINE static __inline__
+    #elif defined(_MSC_VER)
+        #define ARENA_INLINE static __inline
+    #else
+        #define ARENA_INLINE static
+    #endif
+#else
+    #define ARENA_INLINE
+#endif
+
+
+/*
+The events passed to ARENA_TRACE. Allocations pass the
+pointer, size and alignment of the allocation, clears the
+region and its index before the clear, expansions the new
+region and size, and destroys the region and its size.
+Batches pass an allocation for each request, a realloc
+that grows in place an allocation of the bytes it added,
+and chaining a block or committing more of a reservation
+an expansion.
+*/
+typedef enum
+{
+    ARENA_EVENT_ALLOC,
+    ARENA_EVENT_CLEAR,
+    ARENA_EVENT_EXPAND,
+    ARENA_EVENT_DESTROY
+} Arena_Event;
+
+
+/*
+Define ARENA_TRACE to have it called on every event. The
+file and line are NULL and 0, unless ARENA_TRACE_LOCATION
+is defined, in which case they are those of the caller.
+*/
+#ifndef ARENA_TRACE
+    #define ARENA_TRACE(event, arena, ptr, size, alignment, file, line)    \
+        ((void)(event), (void)(arena), (void)(ptr), (void)(size),         \
+         (void)(alignment), (void)(file), (void)(line))
+#endif
+
+/*
+With ARENA_TRACE_LOCATION the *_at functions trace instead.
+Events no *_at function covers are traced in either mode,
+and allocations those functions make through the untraced
+ones are traced in that mode alone.
+*/
+#ifdef ARENA_TRACE_LOCATION
+    #define ARENA_TRACE_EVENT(event, arena, ptr, size, alignment) ((void)0)
+    #define ARENA_TRACE_NESTED(event, arena, ptr, size, alignment) \
+        ARENA_TRACE(event, arena, ptr, size, alignment, NULL, 0)
+#else
+    #define ARENA_TRACE_EVENT(event, arena, ptr, size, alignment) \
+        ARENA_TRACE(event, arena, ptr, size, alignment, NULL, 0)
+    #define ARENA_TRACE_NESTED(event, arena, ptr, size, alignment) ((void)0)
+#endif
+#define ARENA_TRACE_UNWRAPPED(event, arena, ptr, size, alignment) \
+    ARENA_TRACE(event, arena, ptr, size, alignment, NULL, 0)
+
+
 #ifndef ARENA_DEFAULT_ALIGNMENT
     #define ARENA_DEFAULT_ALIGNMENT ARENA_ALIGNOF(size_t)
 #endif
 
 
+/*
+Alignments for vector loads and stores. ARENA_SIMD_ALIGNMENT
+is the widest one the target is being compiled for, and can
+be defined before including arena.h to choose another.
+*/
+#define ARENA_ALIGNMENT_SSE 16
+#define ARENA_ALIGNMENT_NEON 16
+#define ARENA_ALIGNMENT_AVX 32
+#define ARENA_ALIGNMENT_AVX512 64
+
+#ifndef ARENA_SIMD_ALIGNMENT
+    #if defined(__AVX512F__)
+        #define ARENA_SIMD_ALIGNMENT ARENA_ALIGNMENT_AVX512
+    #elif defined(__AVX__)
+        #define ARENA_SIMD_ALIGNMENT ARENA_ALIGNMENT_AVX
+    #else
+        #define ARENA_SIMD_ALIGNMENT ARENA_ALIGNMENT_SSE
+    #endif
+#endif
+
+
+/*
+The span that two threads writing near each other can
+falsely share. Apple's ARM chips and POWER use 128 byte
+lines, and most everything else 64.
+*/
+#ifndef ARENA_CACHE_LINE_SIZE
+    #if (defined(__APPLE__) && defined(__aarch64__)) || defined(__powerpc64__)
+        #define ARENA_CACHE_LINE_SIZE 128
+    #else
+        #define ARENA_CACHE_LINE_SIZE 64
+    #endif
+#endif
+
+
+/*
+Bytes needed to move address up to the next multiple of
+alignment. Power of two alignments are masked rather than
+divided, and a constant alignment folds away entirely.
+*/
+#define ARENA_ALIGN_PADDING(address, alignment)                               \
+    ((alignment) <= 1 ? (size_t)0                                             \
+     : ((alignment) & ((alignment) - 1)) == 0                                 \
+        ? (size_t)(0 - (size_t)(address)) & ((size_t)(alignment) - 1)         \
+        : ((size_t)(alignment) - (size_t)(address) % (alignment)) % (alignment))
+
+
+/*
+Offsets into an arena's region, for links stored inside the
+arena itself. Unlike pointers they stay valid when the
+region is moved by arena_expand, duplicated by arena_copy, or
+saved and mapped back in. They are stored off by one, so
+zero, and with it zeroed memory, is the null offset.
+Arena_Offset32 halves their size for regions under 4 GiB.
+*/
+typedef size_t Arena_Offset;
+#if __STDC_VERSION__ >= 199901L || defined(__cplusplus)
+    #include <stdint.h>
+    typedef uint32_t Arena_Offset32;
+#else
+    typedef unsigned int Arena_Offset32;
+#endif
+
+#define ARENA_OFFSET_NULL 0
+
+/*
+Offsets are relative to the current region, so the pointer
+must be inside it and not in an earlier chained block. The
+pointer and offset are evaluated more than once.
+*/
+#define ARENA_OFFSET(arena, pointer)                                      \
+    ((pointer) == NULL ? (Arena_Offset)ARENA_OFFSET_NULL                  \
+     : (Arena_Offset)((char *)(pointer) - (arena)->region) + 1)
+#define ARENA_OFFSET32(arena, pointer)                                    \
+    ((Arena_Offset32)ARENA_OFFSET(arena, pointer))
+#define ARENA_RESOLVE(arena, offset)                                      \
+    ((offset) == ARENA_OFFSET_NULL ? NULL                                 \
+     : (void *)((arena)->region + (size_t)(offset) - 1))
+
+
+/* Ownership flags, deciding what arena_destroy and arena_expand may free or move */
+#define ARENA_FLAG_FREE_REGION 0x1u
+#define ARENA_FLAG_FREE_ARENA 0x2u
+#define ARENA_FLAG_VIRTUAL 0x4u
+
+/* Options for arena_create_virtual, kept in the same flags */
+#define ARENA_FLAG_HUGE_PAGES 0x8u
+#define ARENA_FLAG_DECOMMIT 0x10u
+
+/* Set by arena_keep_zeroed: the region past the index is always zero */
+#define ARENA_FLAG_ZERO 0x20u
+
+/* Set on arenas from arena_map, which can ask for a private writable copy */
+#define ARENA_FLAG_MAPPED 0x40u
+#define ARENA_FLAG_COPY_ON_WRITE 0x80u
+
+/* Mapped without ARENA_FLAG_COPY_ON_WRITE, so the region must never be written */
+#define ARENA_READ_ONLY(arena) \
+    (((arena)->flags & (ARENA_FLAG_MAPPED | ARENA_FLAG_COPY_ON_WRITE)) == ARENA_FLAG_MAPPED)
+
+/* Set by arena_guard: every allocation is followed by a canary */
+#define ARENA_FLAG_GUARD 0x100u
+
+
+/*
+Images from arena_save keep the region at the same offset
+within a page of this many bytes as it was in memory, so
+allocations keep their alignment when mapped back.
+*/
+#define ARENA_IMAGE_ALIGNMENT 4096
+
+
+/*
+Virtual arenas commit memory in steps of this many bytes,
+or of a huge page with ARENA_FLAG_HUGE_PAGES. Both must be
+multiples of the system's page size.
+*/
+#ifndef ARENA_COMMIT_SIZE
+    #define ARENA_COMMIT_SIZE 65536
+#endif
+
+/* The most NUMA nodes that memory can be bound to, or that an Arena_Nodes spans */
+#ifndef ARENA_MAX_NODES
+    #define ARENA_MAX_NODES 64
+#endif
+
+/* The most arenas an Arena_Ring can rotate between */
+#ifndef ARENA_RING_MAX
+    #define ARENA_RING_MAX 8
+#endif
+
+#ifndef ARENA_HUGE_PAGE_SIZE
+    #define ARENA_HUGE_PAGE_SIZE 2097152
+#endif
+
+
 #ifdef ARENA_DEBUG
 
 /* We are debugging this arena allocator, not your implementation of malloc/free */
@@ -274,385 +520,4871 @@ typedef struct Arena_Allocation_s
     struct Arena_Allocation_s *next;
 } Arena_Allocation;
 
+
+/*
+Allocation structs are kept in fixed-size chunks, so that
+appending one never moves the others and any of them can
+be found by its position in O(1).
+*/
+#define ARENA_ALLOCATION_CHUNK 256
+#define ARENA_ALLOCATION_AT(arena, position)                           \
+    ((arena)->allocation_chunks[(position) / ARENA_ALLOCATION_CHUNK] \
+     + (position) % ARENA_ALLOCATION_CHUNK)
+
 #endif /* ARENA_DEBUG */
 
 
+#ifdef ARENA_STATS
+
+/*
+Counters kept by every arena when ARENA_STATS is defined.
+Unlike ARENA_DEBUG, keeping them costs a few additions per
+allocation, so they can stay on in release builds.
+*/
+typedef struct
+{
+    size_t peak;
+    size_t requested;
+    size_t padding;
+    unsigned long failures;
+    unsigned long expansions;
+} Arena_Stats;
+
+
+/* Called after the index has been bumped past an allocation */
+#define ARENA_STATS_PEAK(arena)                                           \
+    ((arena)->stats.peak < (arena)->index                                 \
+        ? (void)((arena)->stats.peak = (arena)->index) : (void)0)
+#define ARENA_STATS_RECORD(arena, size, offset)                           \
+    ((arena)->stats.requested += (size), (arena)->stats.padding += (offset), \
+     ARENA_STATS_PEAK(arena))
+
+#endif /* ARENA_STATS */
+
+
+/*
+Stored at the start of every chained block. It records the
+block that was current before this one was chained, so the
+memory for the block header and its region is a single
+allocation.
+*/
+typedef struct Arena_Block_s
+{
+    char *region;
+    size_t index;
+    size_t size;
+    struct Arena_Block_s *prev;
+    size_t growth_step;
+
+    #ifdef ARENA_DEBUG
+    unsigned long allocations;
+    #endif /* ARENA_DEBUG */
+} Arena_Block;
+
+
 typedef struct
 {
     char *region;
     size_t index;
     size_t size;
 
+    Arena_Block *blocks;
+    unsigned int growth;
+    unsigned int flags;
+    unsigned long generation;
+    size_t reserved;
+    size_t dirty;
+    size_t growth_limit;
+    size_t growth_step;
+
+    #ifdef ARENA_STATS
+    Arena_Stats stats;
+    #endif /* ARENA_STATS */
+
     #ifdef ARENA_DEBUG
     unsigned long allocations;
     Arena_Allocation *head_allocation;
+    Arena_Allocation **allocation_chunks;
+    unsigned long allocation_chunk_count;
     #endif /* ARENA_DEBUG */
 } Arena;
 
 
 /*
-Allocate and return a pointer to memory to the arena
-with a region with the specified size. Providing a
-size of zero results in a failure.
-
-Parameters:
-  size_t size    |    The size (in bytes) of the arena
-                      memory region.
-Return:
-  Pointer to arena on success, NULL on failure
+A saved position in an arena, used to roll the arena back
+to the state it was in when the marker was taken.
 */
-Arena* arena_create(size_t size);
+typedef struct
+{
+    Arena_Block *block;
+    size_t index;
+
+    #ifdef ARENA_DEBUG
+    unsigned long allocations;
+    #endif /* ARENA_DEBUG */
+} Arena_Marker;
 
 
 /*
-Reallocate an arena's region to a greater or equal size.
-Returns the realloc'd arena on success, and NULL on failure.
-Passing a null arena, providing a size less than or equal
-to the arena's current size, or a failed realloc call will
-all result in returning NULL.
-
-Parameters
-  Arena *arena    |    The arena whose region is being
-                       realloc'd
-  size_t size     |    The size the arena's region is
-                       being changed to
+The start of a file written by arena_save. The region
+follows at offset bytes from the start of the file. Images
+are only meant to be read back on the platform that wrote
+them.
 */
-Arena* arena_expand(Arena *arena, size_t size);
+typedef struct
+{
+    char magic[8];
+    size_t index;
+    size_t offset;
+} Arena_Image;
 
 
 /*
-Return a pointer to a portion of specified size of the
-specified arena's region. Nothing will restrict you
-from allocating more memory than you specified, so be
-mindful of your memory (as you should anyways) or you
-will get some hard-to-track bugs. By default, memory is
-aligned by alignof(size_t), but you can change this by
-#defining ARENA_DEFAULT_ALIGNMENT before #include'ing
-arena.h. Providing a size of zero results in a failure.
-
-Parameters:
-  Arena *arena    |    The arena of which the pointer
-                       from the region will be
-                       distributed
-  size_t size     |    The size (in bytes) of
-                       allocated memory planned to be
-                       used.
-Return:
-  Pointer to arena region segment on success, NULL on
-  failure.
+One allocation in a batch made with arena_alloc_batch. The
+size and alignment are filled in by the caller, and the
+pointer by the arena.
 */
-void* arena_alloc(Arena *arena, size_t size);
+typedef struct
+{
+    size_t size;
+    unsigned int alignment;
+    void *pointer;
+} Arena_Request;
 
 
 /*
-Same as arena_alloc, except you can specify a memory
-alignment for allocations.
+A pool of same-sized slots carved out of an arena. Freed
+slots are kept on an intrusive free list and handed out
+again before any more of the arena is used.
+*/
+typedef struct
+{
+    Arena *arena;
+    void *free_list;
+    size_t slot_size;
+    unsigned int alignment;
+    unsigned long generation;
+} Arena_Pool;
 
-Return a pointer to a portion of specified size of the
-specified arena's region. Nothing will restrict you
-from allocating more memory than you specified, so be
-mindful of your memory (as you should anyways) or you
-will get some hard-to-track bugs. Providing a size of
-zero results in a failure.
 
-Parameters:
-  Arena *arena              |    The arena of which the pointer
-                                 from the region will be
-                                 distributed
-  size_t size               |    The size (in bytes) of
-                                 allocated memory planned to be
-                                 used.
-  unsigned int alignment    |    Alignment (in bytes) for each
-                                 memory allocation.
-Return:
-  Pointer to arena region segment on success, NULL on
-  failure.
-*/
-void* arena_alloc_aligned(Arena *arena, size_t size, unsigned int alignment);
+/* Alignments of 1, 8, 16 and 64, see arena_classes_alloc */
+#define ARENA_CLASS_COUNT 4
 
 
 /*
-Copy the memory contents of one arena to another.
+A front end to an arena that keeps a separate bump cursor
+for each class of alignment, each in its own chunk carved
+out of the arena, so that allocations of different
+alignments do not pad each other.
+*/
+typedef struct
+{
+    Arena *arena;
+    char *regions[ARENA_CLASS_COUNT];
+    size_t indices[ARENA_CLASS_COUNT];
+    size_t sizes[ARENA_CLASS_COUNT];
+    size_t chunk_size;
+    unsigned long generation;
+} Arena_Classes;
 
-Parameters:
-  Arena *src     |    The arena being copied, the source.
-  Arena *dest    |    The arena being copied to. Must be created/allocated
-                      already.
 
-Return:
-  Number of bytes copied.
+/* One bucket for each power of two a region's size can be */
+#define ARENA_CACHE_BUCKETS (sizeof(size_t) * 8)
+
+
+/*
+Arenas kept for reuse instead of being destroyed. Bucket n
+holds cleared arenas whose size is at least 2^n and less
+than 2^(n + 1), most recently released first, linked
+through the start of their regions.
 */
-size_t arena_copy(Arena *dest, Arena *src);
+typedef struct
+{
+    Arena *buckets[ARENA_CACHE_BUCKETS];
+    size_t retained;
+    size_t capacity;
+} Arena_Cache;
 
 
 /*
-Reset the pointer to the arena region to the beginning
-of the allocation. Allows reuse of the memory without
-realloc or frees.
+A ring of arenas for data that lives for a fixed number of
+epochs. Allocations go to the current arena, and advancing
+the epoch clears the oldest arena and makes it current, so
+nothing has to be copied out of an arena to outlive it.
+*/
+typedef struct
+{
+    Arena *arenas[ARENA_RING_MAX];
+    unsigned int count;
+    unsigned int current;
+    unsigned long epoch;
+} Arena_Ring;
 
-Parameters:
-  Arena *arena    |    The arena to be cleared.
+
+/* Finished contents of an Arena_Array or Arena_String */
+typedef struct
+{
+    void *data;
+    size_t count;
+} Arena_Slice;
+
+
+/*
+A growable array in an arena. Its storage is an ordinary
+allocation, grown in place while it is the most recent one
+in the arena and moved otherwise, doubling each time.
 */
-void arena_clear(Arena* arena);
+typedef struct
+{
+    Arena *arena;
+    char *data;
+    size_t count;
+    size_t capacity;
+    size_t element_size;
+    unsigned int alignment;
+} Arena_Array;
 
 
 /*
-Free the memory allocated for the entire arena region.
+A string builder in an arena, which grows like an
+Arena_Array of chars and is always NUL terminated once
+anything has been appended.
+*/
+typedef struct
+{
+    Arena *arena;
+    char *data;
+    size_t length;
+    size_t capacity;
+} Arena_String;
 
-Parameters:
-  Arena *arena    |    The arena to be destroyed.
+
+/*
+An arena of a fixed capacity whose region is stored inline,
+for scratch space on the stack or in static storage with
+no Arena to allocate or point to. Each use is its own type,
+so name it with a typedef, and zero it to make it empty:
+
+    typedef ARENA_FIXED(4096) Frame_Arena;
+    Frame_Arena scratch = {0};
+    char *ptr = ARENA_FIXED_ALLOC(scratch, 64, 16);
 */
-void arena_destroy(Arena *arena);
+#define ARENA_FIXED(capacity)                                             \
+    struct                                                                \
+    {                                                                     \
+        size_t index;                                                     \
+        char region[capacity];                                            \
+    }
 
+/* The capacity is the size of the region, so it is always a constant */
+#define ARENA_FIXED_ALLOC(fixed, size, alignment)                         \
+    arena_fixed_alloc((fixed).region, &(fixed).index, sizeof((fixed).region), size, alignment)
+#define ARENA_FIXED_CLEAR(fixed) ((void)((fixed).index = 0))
 
-#ifdef ARENA_DEBUG
 
-/*
-Returns a pointer to the allocation struct associated
-with a pointer to a segment in the specified arena's
-region.
+#ifdef ARENA_HAS_ATOMICS
 
-Parameters:
-  Arena *arena    |    The arena whose region should
-                       have a portion pointed to by
-                       ptr.
-  void *ptr       |    The ptr being searched for
-                       within the arena in order to
-                       find an allocation struct
-                       associated with it.
+/*
+An arena that any number of threads may allocate from at
+once without locking. The index is only ever advanced
+with atomic operations. Only available for C11 and later
+compilers with atomics.
 */
-Arena_Allocation* arena_get_allocation_struct(Arena *arena, void *ptr);
+typedef struct
+{
+    char *region;
+    atomic_size_t index;
+    size_t size;
+    atomic_ulong generation;
+} Arena_Concurrent;
 
 
 /*
-Adds an arena allocation to the arena's linked list of
-allocations under debug.
+A per-thread front end to a concurrent arena. Each thread
+carves private chunks out of the shared parent and bump
+allocates from them without atomics, only going back to
+the parent when its chunk runs out. Each thread should own
+one, for example as a _Thread_local variable.
+*/
+typedef struct
+{
+    Arena_Concurrent *parent;
+    char *region;
+    size_t index;
+    size_t size;
+    size_t chunk_size;
+    unsigned long generation;
+} Arena_Local;
+
+
+/*
+A concurrent arena for each NUMA node, so that threads can
+allocate from the one on their own node. Pair it with an
+Arena_Local per thread to avoid the atomics as well.
+*/
+typedef struct
+{
+    Arena_Concurrent *arenas[ARENA_MAX_NODES];
+    int count;
+} Arena_Nodes;
+
+#endif /* ARENA_HAS_ATOMICS */
+
+
+/*
+Allocate and return a pointer to memory to the arena
+with a region with the specified size. Providing a
+size of zero results in a failure.
+
+Parameters:
+  size_t size    |    The size (in bytes) of the arena
+                      memory region.
+Return:
+  Pointer to arena on success, NULL on failure
+*/
+Arena* arena_create(size_t size);
+
+
+/*
+Same as arena_create, except that when the arena runs out
+of memory a new block is chained onto it instead of the
+allocation failing. Previously allocated pointers stay
+valid, since existing blocks are never moved. Every new
+block is the size of the block before it multiplied by
+growth, or large enough for the allocation if that is
+bigger. A growth of 1 gives fixed-size blocks. Use
+arena_set_growth to cap the size of blocks. Providing
+a size or growth of zero results in a failure.
+
+Parameters:
+  size_t size           |    The size (in bytes) of the
+                             first block.
+  unsigned int growth   |    The multiplier applied to the
+                             size of each following block.
+Return:
+  Pointer to arena on success, NULL on failure
+*/
+Arena* arena_create_chained(size_t size, unsigned int growth);
+
+
+/*
+Same as arena_create, except that the arena and its region
+are placed in a single allocation, with the region directly
+after the arena. This halves the malloc and free calls made
+over the arena's lifetime, and keeps the arena on the same
+cache line as the start of its region. Providing a size of
+zero results in a failure.
+
+Parameters:
+  size_t size    |    The size (in bytes) of the arena
+                      memory region.
+Return:
+  Pointer to arena on success, NULL on failure
+*/
+Arena* arena_create_inline(size_t size);
+
+
+/*
+Create an arena inside of memory owned by the caller, such
+as a stack or static array or an allocation from another
+arena. The arena is placed at the start of the buffer and
+the rest of the buffer becomes its region, so no memory is
+allocated. arena_destroy will not free the buffer. Passing
+a null buffer or a buffer too small to hold the arena and
+at least one byte of region results in a failure.
+
+Parameters:
+  void *buffer    |    The memory the arena is created in.
+  size_t size     |    The size (in bytes) of the buffer.
+Return:
+  Pointer to arena on success, NULL on failure
+*/
+Arena* arena_create_from_buffer(void *buffer, size_t size);
+
+
+/*
+Create an arena in a range of address space reserved with
+mmap or VirtualAlloc rather than ARENA_MALLOC. The arena is
+placed at the start of the range, and memory is committed
+in steps of ARENA_COMMIT_SIZE as allocations need it, so
+growing never moves the region and reserving far more than
+is used costs no memory. arena_destroy returns the whole
+range to the system. ARENA_FLAG_HUGE_PAGES asks for
+transparent huge pages and commits in steps of
+ARENA_HUGE_PAGE_SIZE, and ARENA_FLAG_DECOMMIT makes
+arena_clear hand committed memory back to the system.
+Providing a reserve of zero, or a platform without mmap or
+VirtualAlloc, results in a failure. On POSIX systems,
+strict -std modes need _DEFAULT_SOURCE (or similar)
+defined for mmap's flags to be declared. Since fresh pages
+are already zero, ARENA_FLAG_ZERO puts the arena in the
+mode of arena_keep_zeroed without clearing anything.
+
+Parameters:
+  size_t reserve        |    The most (in bytes) the arena
+                             can ever commit.
+  unsigned int flags    |    Any of ARENA_FLAG_HUGE_PAGES,
+                             ARENA_FLAG_DECOMMIT and
+                             ARENA_FLAG_ZERO, or 0.
+Return:
+  Pointer to arena on success, NULL on failure
+*/
+Arena* arena_create_virtual(size_t reserve, unsigned int flags);
+
+
+/*
+Commit enough of a virtual arena's reserved range for its
+region to hold at least size bytes. The region keeps its
+address. Passing a null arena, an arena that is not
+virtual or has chained blocks, a size beyond the
+reservation, or a failed commit will all result in
+returning NULL.
+
+Parameters:
+  Arena *arena    |    The virtual arena being committed.
+  size_t size     |    The size (in bytes) the region must
+                       at least reach.
+Return:
+  The arena on success, NULL on failure.
+*/
+Arena* arena_commit(Arena *arena, size_t size);
+
+
+/*
+Hand every committed page of a virtual arena after the
+first commit step back to the system, shrinking its region
+to that first step. Memory is committed again, zeroed, as
+allocations need it. Called by arena_clear for arenas
+created with ARENA_FLAG_DECOMMIT. Does nothing unless the
+arena is virtual and empty.
+
+Parameters:
+  Arena *arena    |    The virtual arena being decommitted.
+*/
+void arena_decommit(Arena *arena);
+
+
+/*
+Return the NUMA node of the CPU the calling thread is
+running on, or 0 where that cannot be found out. Threads
+can be moved between nodes unless they are pinned, so the
+result is only a hint.
+
+Return:
+  The node of the caller.
+*/
+int arena_current_node(void);
+
+
+/*
+Return the number of NUMA nodes this process may allocate
+memory on, capped at ARENA_MAX_NODES, or 1 where that
+cannot be found out.
+
+Return:
+  The number of nodes.
+*/
+int arena_node_count(void);
+
+
+/*
+Ask for the whole pages within memory to be placed on the
+given NUMA node, moving any that are already placed.
+Pages not placed yet are placed on the node as they are
+touched, falling back to others when the node is out of
+memory. Only supported on Linux. Elsewhere, leave memory
+untouched until the thread that uses it touches it first,
+which places it on that thread's node. Passing null
+memory, a size of zero, a node that is out of range, or a
+platform that cannot bind memory will all result in
+returning NULL.
+
+Parameters:
+  void *memory    |    The memory being bound.
+  size_t size     |    The size (in bytes) of the memory.
+  int node        |    The node it should be placed on.
+Return:
+  The memory on success, NULL on failure.
+*/
+void* arena_bind_memory(void *memory, size_t size, int node);
+
+
+/*
+Bind an arena's region to a NUMA node with
+arena_bind_memory. For virtual arenas the whole
+reservation is bound, so memory committed later is placed
+on the node as well. Blocks chained later are not bound.
+Passing a null arena, or a failure to bind, will result in
+returning NULL, though the arena can still be used.
+
+Parameters:
+  Arena *arena    |    The arena being bound.
+  int node        |    The node it should be placed on.
+Return:
+  The arena on success, NULL on failure.
+*/
+Arena* arena_bind_node(Arena *arena, int node);
+
+
+/*
+Reallocate an arena's region to a greater or equal size.
+Returns the realloc'd arena on success, and NULL on failure.
+Arenas from arena_create_inline are moved along with their
+region, so the returned pointer must be used from then on.
+Virtual arenas commit more of their reservation instead,
+so their region never moves. Arenas that have chained a
+block chain another of at least size bytes, since blocks
+never move.
+Passing a null arena, providing a size less than or equal
+to the arena's current size, expanding an arena created
+from a buffer, or a failed realloc call will all result
+in returning NULL.
+
+Parameters
+  Arena *arena    |    The arena whose region is being
+                       realloc'd
+  size_t size     |    The size the arena's region is
+                       being changed to
+*/
+Arena* arena_expand(Arena *arena, size_t size);
+
+
+/*
+Chain a new block onto the arena and make it the block
+that allocations are made from. The block is at least
+size bytes, and at least the current block's size
+multiplied by the arena's growth, though no bigger than
+its growth limit unless size is. The block being
+replaced is kept, along with everything allocated in it,
+until the arena is cleared or destroyed. Passing a null
+arena, a size of zero, or a failed malloc call will all
+result in returning NULL.
+
+Parameters:
+  Arena *arena    |    The arena being chained onto.
+  size_t size     |    The minimum size (in bytes) of
+                       the new block.
+Return:
+  The arena on success, NULL on failure.
+*/
+Arena* arena_add_block(Arena *arena, size_t size);
+
+
+/*
+Free the arena's current chained block, making the block
+that was current before it the one allocations are made
+from again. The arena's generation is incremented, as for
+arena_clear. Does nothing if the arena has no chained
+blocks.
+
+Parameters:
+  Arena *arena    |    The arena whose current block is
+                       being freed.
+*/
+void arena_pop_block(Arena *arena);
+
+
+/*
+Set how the arena grows when an allocation does not fit,
+so that any arena can chain blocks like one from
+arena_create_chained. Each new block is the arena's
+growth_step multiplied by growth, which then becomes the
+step, so a growth of 2 doubles them and a growth of 1
+gives blocks of a fixed step. The step starts out as the
+size of the arena's region, and can be set directly to
+choose another. Blocks stop growing once they reach limit
+bytes, and a limit of zero leaves them uncapped. An
+allocation that needs more gets a block of its own size,
+without changing the step. Blocks are chained rather than
+realloc'd, so nothing is ever copied and previously
+allocated pointers stay valid. Virtual arenas commit more
+of their reservation until it runs out, and only then
+chain. A growth of zero stops the arena from growing.
+Passing a null arena or one from arena_map results in
+returning NULL.
+
+Parameters:
+  Arena *arena          |    The arena whose growth is
+                             being set.
+  unsigned int growth   |    The multiplier applied to the
+                             size of each following block.
+  size_t limit          |    The largest size (in bytes) a
+                             block grows to, or zero.
+Return:
+  The arena on success, NULL on failure.
+*/
+Arena* arena_set_growth(Arena *arena, unsigned int growth, size_t limit);
+
+
+/*
+Make sure the next size bytes of the arena can be handed
+out without the arena having to grow, such as to size it
+up front for a known workload. Virtual arenas commit more
+of their reservation, and chained arenas chain a new
+block. Passing a null arena, a size of zero, or an
+arena that cannot grow far enough will all result in
+returning NULL.
+
+Parameters:
+  Arena *arena    |    The arena making room.
+  size_t size     |    The size (in bytes) that must fit
+                       past the arena's index.
+Return:
+  The arena on success, NULL on failure.
+*/
+Arena* arena_reserve(Arena *arena, size_t size);
+
+
+/*
+Return a pointer to a portion of specified size of the
+specified arena's region. Nothing will restrict you
+from allocating more memory than you specified, so be
+mindful of your memory (as you should anyways) or you
+will get some hard-to-track bugs. By default, memory is
+aligned by alignof(size_t), but you can change this by
+#defining ARENA_DEFAULT_ALIGNMENT before #include'ing
+arena.h. Providing a size of zero results in a failure.
+
+Parameters:
+  Arena *arena    |    The arena of which the pointer
+                       from the region will be
+                       distributed
+  size_t size     |    The size (in bytes) of
+                       allocated memory planned to be
+                       used.
+Return:
+  Pointer to arena region segment on success, NULL on
+  failure.
+*/
+ARENA_INLINE void* arena_alloc(Arena *arena, size_t size);
+
+
+/*
+Same as arena_alloc, except you can specify a memory
+alignment for allocations.
+
+Return a pointer to a portion of specified size of the
+specified arena's region. Nothing will restrict you
+from allocating more memory than you specified, so be
+mindful of your memory (as you should anyways) or you
+will get some hard-to-track bugs. Providing a size of
+zero results in a failure.
+
+Parameters:
+  Arena *arena              |    The arena of which the pointer
+                                 from the region will be
+                                 distributed
+  size_t size               |    The size (in bytes) of
+                                 allocated memory planned to be
+                                 used.
+  unsigned int alignment    |    Alignment (in bytes) for each
+                                 memory allocation.
+Return:
+  Pointer to arena region segment on success, NULL on
+  failure.
+*/
+ARENA_INLINE void* arena_alloc_aligned(Arena *arena, size_t size, unsigned int alignment);
+
+
+/*
+Same as arena_alloc_aligned, with an alignment of
+ARENA_SIMD_ALIGNMENT.
+
+Parameters:
+  Arena *arena    |    The arena being allocated from.
+  size_t size     |    The size (in bytes) of the
+                       allocation.
+Return:
+  Pointer to arena region segment on success, NULL on
+  failure.
+*/
+ARENA_INLINE void* arena_alloc_simd(Arena *arena, size_t size);
+
+
+/*
+Same as arena_alloc_aligned, with an alignment of
+ARENA_CACHE_LINE_SIZE, and the size rounded up to whole
+cache lines. Nothing else allocated from the arena will
+share a line with the allocation, so it can be written by
+one thread while its neighbours are written by others.
+
+Parameters:
+  Arena *arena    |    The arena being allocated from.
+  size_t size     |    The size (in bytes) of the
+                       allocation.
+Return:
+  Pointer to arena region segment on success, NULL on
+  failure.
+*/
+ARENA_INLINE void* arena_alloc_cache_line(Arena *arena, size_t size);
+
+
+/*
+The allocation behind ARENA_FIXED_ALLOC, which should be
+used instead of calling this directly. With
+ARENA_INLINE_HOT_PATH the capacity is a constant at every
+call, and so are the checks against it when the size is.
+Fixed arenas have no Arena, so they are not traced and keep
+no statistics or debug allocations. Providing a size of
+zero, or a size that does not fit, results in a failure.
+
+Parameters:
+  char *region              |    The fixed arena's region.
+  size_t *index             |    The fixed arena's index.
+  size_t capacity           |    The size (in bytes) of the
+                                 region.
+  size_t size               |    The size (in bytes) of the
+                                 allocation.
+  unsigned int alignment    |    Alignment (in bytes) of the
+                                 allocation.
+Return:
+  Pointer to region segment on success, NULL on failure.
+*/
+ARENA_INLINE void* arena_fixed_alloc(char *region, size_t *index, size_t capacity, size_t size,
+                                     unsigned int alignment);
+
+
+/*
+The slow path of arena_alloc_aligned, taken when an
+allocation does not fit in the arena's current block.
+Kept out of line so the common path stays small. For
+chained arenas a block big enough for the allocation is
+chained before allocating from it. Arenas that cannot
+grow, or a failed malloc call, result in returning NULL.
+
+Parameters:
+  Arena *arena              |    The arena being allocated
+                                 from.
+  size_t size               |    The size (in bytes) of the
+                                 allocation.
+  unsigned int alignment    |    Alignment (in bytes) of the
+                                 allocation.
+Return:
+  Pointer to arena region segment on success, NULL on
+  failure.
+*/
+void* arena_alloc_grow(Arena *arena, size_t size, unsigned int alignment);
+
+
+/*
+Resize an allocation. When ptr is the most recent
+allocation in the arena's current block it is grown or
+shrunk in place, by moving the arena's index, with virtual
+arenas committing more of their reservation to make room
+if they have to. Otherwise
+shrinking leaves it where it is, and growing allocates a
+new segment aligned by ARENA_DEFAULT_ALIGNMENT, copies the
+contents over and leaves the old segment unused. A null
+ptr behaves like arena_alloc. Providing a new size of zero
+results in a failure.
+
+Parameters:
+  Arena *arena       |    The arena ptr was allocated from.
+  void *ptr          |    The allocation being resized.
+  size_t old_size    |    The size (in bytes) ptr was
+                          allocated with.
+  size_t new_size    |    The size (in bytes) ptr is being
+                          resized to.
+Return:
+  Pointer to the resized allocation on success, NULL on
+  failure, in which case ptr is left untouched.
+*/
+void* arena_realloc(Arena *arena, void *ptr, size_t old_size, size_t new_size);
+
+
+/*
+Same as arena_realloc, except that an allocation that has
+to move is aligned by the specified alignment, which
+should be the one ptr was allocated with.
+
+Parameters:
+  Arena *arena              |    The arena ptr was allocated
+                                 from.
+  void *ptr                 |    The allocation being
+                                 resized.
+  size_t old_size           |    The size (in bytes) ptr was
+                                 allocated with.
+  size_t new_size           |    The size (in bytes) ptr is
+                                 being resized to.
+  unsigned int alignment    |    Alignment (in bytes) of the
+                                 allocation.
+Return:
+  Pointer to the resized allocation on success, NULL on
+  failure, in which case ptr is left untouched.
+*/
+void* arena_realloc_aligned(Arena *arena, void *ptr, size_t old_size, size_t new_size, unsigned int alignment);
+
+
+/*
+Same as arena_alloc, except that the memory is for count
+objects of size bytes each and is zeroed. Arenas kept
+zeroed by arena_keep_zeroed hand the memory out without
+touching it. A size that overflows, or a total size of
+zero, results in a failure.
+
+Parameters:
+  Arena *arena     |    The arena being allocated from.
+  size_t count     |    The number of objects.
+  size_t size      |    The size (in bytes) of each object.
+Return:
+  Pointer to zeroed arena region segment on success, NULL
+  on failure.
+*/
+void* arena_calloc(Arena *arena, size_t count, size_t size);
+
+
+/*
+Same as arena_calloc, except you can specify a memory
+alignment for the allocation.
+
+Parameters:
+  Arena *arena              |    The arena being allocated
+                                 from.
+  size_t count              |    The number of objects.
+  size_t size               |    The size (in bytes) of each
+                                 object.
+  unsigned int alignment    |    Alignment (in bytes) of the
+                                 allocation.
+Return:
+  Pointer to zeroed arena region segment on success, NULL
+  on failure.
+*/
+void* arena_calloc_aligned(Arena *arena, size_t count, size_t size, unsigned int alignment);
+
+
+/*
+Allocate every request in one go, laying them out one
+after another in order, each aligned by its own alignment.
+The layout is worked out once, and there is a single
+bounds check and a single bump of the arena's index. Each
+request's pointer is filled in on success, and nothing is
+allocated on failure. Passing a null arena or requests, a
+count of zero, or any request with a size of zero results
+in a failure.
+
+Parameters:
+  Arena *arena               |    The arena being allocated
+                                  from.
+  Arena_Request *requests    |    The sizes and alignments
+                                  of the allocations.
+  size_t count               |    The number of requests.
+Return:
+  Pointer to the first allocation on success, NULL on
+  failure.
+*/
+void* arena_alloc_batch(Arena *arena, Arena_Request *requests, size_t count);
+
+
+/*
+Copy the memory contents of one arena to another. For
+chained arenas only the current blocks are involved.
+
+Parameters:
+  Arena *src     |    The arena being copied, the source.
+  Arena *dest    |    The arena being copied to. Must be created/allocated
+                      already.
+
+Return:
+  Number of bytes copied.
+*/
+size_t arena_copy(Arena *dest, Arena *src);
+
+
+/*
+Copy only what has changed in src since it was last copied
+to dest with arena_copy or arena_copy_delta, so that
+keeping two arenas in sync costs as much as what changed
+rather than the whole arena. Allocations, clears and
+rewinds are tracked by the arena, but writes to memory
+allocated before the last copy must be reported with
+arena_touch. The changes are tracked per source, so each
+source should only be kept in sync with one destination.
+
+Parameters:
+  Arena *src     |    The arena being copied, the source.
+  Arena *dest    |    The arena last synced from src.
+
+Return:
+  Number of bytes copied.
+*/
+size_t arena_copy_delta(Arena *dest, Arena *src);
+
+
+/*
+Report a write to memory that was allocated before the last
+arena_copy or arena_copy_delta from this arena, so that the
+next arena_copy_delta copies it again. Everything from the
+pointer up to the index is copied. Pointers outside of the
+current block are ignored.
+
+Parameters:
+  Arena *arena       |    The arena the memory is from.
+  void *pointer      |    The start of what was written.
+*/
+void arena_touch(Arena *arena, void *pointer);
+
+
+/*
+Make a new arena with the same contents as this one. Read-only
+arenas from arena_map are mapped again with
+ARENA_FLAG_COPY_ON_WRITE, so the two share every page until
+the new arena writes to it. Any other arena is copied into a
+new arena of the same size that is freed like one from
+arena_create_inline. The copy's region sits at the same offset
+within ARENA_IMAGE_ALIGNMENT bytes as the original's, so
+allocations aligned to up to that many bytes are still aligned
+in the fork. Passing a null arena or failing to allocate will
+result in returning NULL.
+
+Parameters:
+  Arena *arena    |    The arena being forked.
+
+Return:
+  Pointer to the new arena on success, NULL on failure.
+*/
+Arena* arena_fork(Arena *arena);
+
+
+/*
+Carve a child arena out of the parent. The child and its
+region of size bytes are a single allocation from the
+parent, made the way arena_create_from_buffer would, so
+nothing is malloc'd and arena_destroy on the child frees
+nothing. Everything allocated from the child lives as long
+as the parent. To throw the child away entirely, rewind
+the parent to a marker taken before the split. Passing a
+null parent, a size of zero, or a parent without room will
+all result in returning NULL.
+
+Parameters:
+  Arena *parent    |    The arena the child is carved from.
+  size_t size      |    The size (in bytes) of the child's
+                        region.
+Return:
+  Pointer to the child arena on success, NULL on failure.
+*/
+Arena* arena_split(Arena *parent, size_t size);
+
+
+/*
+Hand the unused part of a child from arena_split back to
+its parent, keeping only what the child has allocated.
+This is only possible while the child is still the most
+recent allocation in the parent's current block, otherwise
+the child's memory stays where it is. The child must not
+be used afterwards, though its allocations stay valid.
+Passing a null parent or child, a child that has chained
+blocks, or one arena_split could not have made, such as a
+virtual or mapped arena, will all result in returning NULL
+and the child being left as it was. A chained child can
+still be destroyed with arena_destroy to free its blocks.
+
+Parameters:
+  Arena *parent    |    The arena the child was carved from.
+  Arena *child     |    The child being merged back.
+Return:
+  Pointer to the parent on success, NULL on failure.
+*/
+Arena* arena_merge(Arena *parent, Arena *child);
+
+
+/*
+Write the used part of the arena's region to a file, along
+with an Arena_Image header, so that it can be mapped back
+with arena_map. For chained arenas only the current block
+is written. Anything stored in the region must refer to
+the rest of it by offsets rather than pointers to stay
+valid once mapped. Passing a null arena or path, or a
+failure to write the file, will all result in returning
+NULL.
+
+Parameters:
+  Arena *arena        |    The arena being saved.
+  const char *path    |    The file being written.
+Return:
+  The arena on success, NULL on failure.
+*/
+Arena* arena_save(Arena *arena, const char *path);
+
+
+/*
+Map a file written by arena_save back in as an arena whose
+index is the saved index. The pages are shared with the
+page cache and every other process mapping the same file,
+and are read-only, so the arena must not be allocated from,
+and arena_clear and arena_rewind leave it alone. With
+ARENA_FLAG_COPY_ON_WRITE they can be written instead, and
+pages are copied as they are written without the file
+changing. Platforms without mmap read the file into a new
+allocation. Passing a null path, or a file that cannot be
+read or was not written by arena_save, will all result in
+returning NULL.
+
+Parameters:
+  const char *path      |    The file being mapped.
+  unsigned int flags    |    ARENA_FLAG_COPY_ON_WRITE, or 0.
+Return:
+  Pointer to arena on success, NULL on failure
+*/
+Arena* arena_map(const char *path, unsigned int flags);
+
+
+/*
+Return a marker for the arena's current position, so that
+everything allocated after this call can later be released
+with arena_rewind. Taking a marker costs a few loads and
+no allocations. Passing a null arena results in a marker
+that arena_rewind ignores.
+
+Parameters:
+  Arena *arena    |    The arena whose position is being
+                       saved.
+Return:
+  Marker for the arena's current position.
+*/
+Arena_Marker arena_mark(Arena *arena);
+
+
+/*
+Roll the arena back to a marker taken with arena_mark,
+releasing everything allocated since. Blocks chained after
+the marker was taken are freed. Markers taken before the
+last arena_clear, or after this marker, are invalidated.
+The arena's generation is incremented when anything is
+released, which resets any pools allocating from it.
+Read-only arenas from arena_map are left as they are, and
+reported through ARENA_GUARD_FAIL in ARENA_GUARD builds.
+
+Parameters:
+  Arena *arena           |    The arena being rolled back.
+  Arena_Marker marker    |    The position being restored.
+*/
+void arena_rewind(Arena *arena, Arena_Marker marker);
+
+
+/*
+Keep everything past the arena's index zero from now on,
+so that arena_calloc never has to clear memory. The unused
+rest of every block is zeroed once here. After that, used
+memory is zeroed in bulk as it is released by arena_clear,
+arena_rewind or arena_realloc, and new blocks or expanded
+regions are zeroed when they are added. Passing a null
+arena results in nothing happening.
+
+Parameters:
+  Arena *arena    |    The arena being kept zeroed.
+*/
+void arena_keep_zeroed(Arena *arena);
+
+
+/*
+Zero the used part of the arena's current block, from the
+start of its region up to its index. Called by arena_clear
+for arenas kept zeroed by arena_keep_zeroed. For virtual
+arenas with ARENA_FLAG_DECOMMIT, only the first commit step
+is zeroed, since the pages past it are decommitted and come
+back zeroed anyway. Passing a null arena results in nothing
+happening.
+
+Parameters:
+  Arena *arena    |    The arena whose used memory is
+                       being zeroed.
+*/
+void arena_zero_used(Arena *arena);
+
+
+/*
+Reset the pointer to the arena region to the beginning
+of the allocation. Allows reuse of the memory without
+realloc or frees. Any chained blocks are freed, leaving
+only the arena's first block. The arena's generation is
+incremented, which resets any pools allocating from it.
+Read-only arenas from arena_map are left as they are, and
+reported through ARENA_GUARD_FAIL in ARENA_GUARD builds.
+
+Parameters:
+  Arena *arena    |    The arena to be cleared.
+*/
+ARENA_INLINE void arena_clear(Arena* arena);
+
+
+/*
+Free the memory allocated for the entire arena region.
+Memory provided by the caller through
+arena_create_from_buffer is left alone.
+
+Parameters:
+  Arena *arena    |    The arena to be destroyed.
+*/
+void arena_destroy(Arena *arena);
+
+
+/*
+Set up a pool handing out slots of slot_size bytes from
+arena. The slot size is raised to hold at least a pointer,
+and the alignment to at least that of a pointer, since
+free slots store the free list. The pool is reset whenever
+the arena is cleared. Passing a null pool results in
+nothing happening, and a null arena or slot size of zero
+leaves the pool unusable.
+
+Parameters:
+  Arena_Pool *pool          |    The pool being set up.
+  Arena *arena              |    The arena slots are carved
+                                 from.
+  size_t slot_size          |    The size (in bytes) of each
+                                 slot.
+  unsigned int alignment    |    Alignment (in bytes) of each
+                                 slot.
+*/
+void arena_pool_init(Arena_Pool *pool, Arena *arena, size_t slot_size, unsigned int alignment);
+
+
+/*
+Return a slot from the pool in O(1) time, reusing a freed
+slot if there is one and allocating a new one from the
+arena otherwise.
+
+Parameters:
+  Arena_Pool *pool    |    The pool being allocated from.
+Return:
+  Pointer to a slot on success, NULL on failure.
+*/
+void* arena_pool_alloc(Arena_Pool *pool);
+
+
+/*
+Return a slot to the pool in O(1) time so it can be handed
+out again. The slot must have come from this pool since
+the arena was last cleared. Null pointers are ignored.
+
+Parameters:
+  Arena_Pool *pool    |    The pool the slot came from.
+  void *ptr           |    The slot being freed.
+*/
+void arena_pool_free(Arena_Pool *pool, void *ptr);
+
+
+/*
+Set up a size class front end that carves chunks of
+chunk_size bytes out of arena. No memory is taken from the
+arena until the first allocation, and the front end is
+reset whenever the arena is cleared. Passing a null
+classes results in nothing happening, and a null arena or
+chunk size of zero leaves the front end unusable.
+
+Parameters:
+  Arena_Classes *classes    |    The front end being set
+                                 up.
+  Arena *arena              |    The arena chunks are carved
+                                 from.
+  size_t chunk_size         |    The size (in bytes) of each
+                                 chunk.
+*/
+void arena_classes_init(Arena_Classes *classes, Arena *arena, size_t chunk_size);
+
+
+/*
+Same as arena_alloc_aligned, but allocating from the chunk
+of the smallest class whose alignment is at least the one
+asked for. Allocations larger than half the chunk size,
+and alignments that are not powers of two or are larger
+than 64, are made from the arena directly. Providing a
+size of zero results in a failure.
+
+Parameters:
+  Arena_Classes *classes    |    The front end being
+                                 allocated from.
+  size_t size               |    The size (in bytes) of the
+                                 allocation.
+  unsigned int alignment    |    Alignment (in bytes) of the
+                                 allocation.
+Return:
+  Pointer to arena region segment on success, NULL on
+  failure.
+*/
+void* arena_classes_alloc(Arena_Classes *classes, size_t size, unsigned int alignment);
+
+
+/*
+Set up an empty arena cache that keeps at most capacity
+bytes of regions. The cache is not thread safe. Passing a
+null cache results in nothing happening.
+
+Parameters:
+  Arena_Cache *cache    |    The cache being set up.
+  size_t capacity       |    The most bytes of regions the
+                             cache keeps.
+*/
+void arena_cache_init(Arena_Cache *cache, size_t capacity);
+
+
+/*
+Take an arena with a region of at least size bytes from the
+cache, the one released most recently out of those close
+in size, so its memory is likely to still be in cache.
+Cached arenas keep their kind, so one made by
+arena_create_chained is still chained. When there is none,
+a new arena is made with arena_create. Providing a size of
+zero results in a failure, and a null cache in always
+making a new arena.
+
+Parameters:
+  Arena_Cache *cache    |    The cache being taken from.
+  size_t size           |    The least size (in bytes) of
+                             the arena memory region.
+Return:
+  Pointer to arena on success, NULL on failure.
+*/
+Arena* arena_cache_acquire(Arena_Cache *cache, size_t size);
+
+
+/*
+Clear the arena and give it to the cache instead of
+destroying it. Arenas that would take the cache over its
+capacity, have a region too small to link through, or
+that arena_destroy would not free are destroyed instead.
+Passing a null cache destroys the arena, and a null arena
+results in nothing happening.
+
+Parameters:
+  Arena_Cache *cache    |    The cache being given the
+                             arena.
+  Arena *arena          |    The arena being released.
+*/
+void arena_cache_release(Arena_Cache *cache, Arena *arena);
+
+
+/*
+Destroy every arena in the cache, leaving it empty but
+still usable. Passing a null cache results in nothing
+happening.
+
+Parameters:
+  Arena_Cache *cache    |    The cache being emptied.
+*/
+void arena_cache_flush(Arena_Cache *cache);
+
+
+/*
+Create a ring of count arenas, each with a region of the
+specified size from arena_create, so that data allocated
+in an epoch lives until count epochs later. A count of 2
+double buffers. Use arena_set_growth on the arenas to let
+them chain. Providing a count less than 2 or greater than
+ARENA_RING_MAX, a size of zero, or a failure to allocate
+any of the arenas results in returning NULL.
+
+Parameters:
+  unsigned int count    |    The number of arenas in the
+                             ring.
+  size_t size           |    The size (in bytes) of each
+                             arena's region.
+Return:
+  Pointer to the ring on success, NULL on failure.
+*/
+Arena_Ring* arena_ring_create(unsigned int count, size_t size);
+
+
+/*
+Return the arena that was current age epochs ago, with an
+age of 0 giving the current one. Everything allocated from
+it in that epoch is still valid. Passing a null ring, or an
+age of count or more, results in returning NULL.
+
+Parameters:
+  Arena_Ring *ring    |    The ring holding the arena.
+  unsigned int age    |    How many epochs ago the arena
+                           was current.
+Return:
+  The arena on success, NULL on failure.
+*/
+Arena* arena_ring_arena(Arena_Ring *ring, unsigned int age);
+
+
+/*
+Same as arena_alloc, from the ring's current arena.
+Providing a size of zero results in a failure.
+
+Parameters:
+  Arena_Ring *ring    |    The ring being allocated from.
+  size_t size         |    The size (in bytes) of the
+                           allocation.
+Return:
+  Pointer to arena region segment on success, NULL on
+  failure.
+*/
+void* arena_ring_alloc(Arena_Ring *ring, size_t size);
+
+
+/*
+Start the next epoch by clearing the oldest arena in the
+ring and making it the current one. Only that arena is
+touched, so another thread can keep reading the arenas of
+the epochs before as long as the pipeline makes sure it is
+done with the oldest one first. The ring itself is not
+thread safe. Passing a null ring results in returning
+NULL.
+
+Parameters:
+  Arena_Ring *ring    |    The ring being advanced.
+Return:
+  The new current arena on success, NULL on failure.
+*/
+Arena* arena_ring_advance(Arena_Ring *ring);
+
+
+/*
+Free the memory of every arena in the ring, and the ring
+itself. Passing a null ring results in nothing happening.
+
+Parameters:
+  Arena_Ring *ring    |    The ring being destroyed.
+*/
+void arena_ring_destroy(Arena_Ring *ring);
+
+
+/*
+Set up an empty array of elements of element_size bytes,
+each aligned by alignment. Nothing is allocated until the
+first append. Passing a null array results in nothing
+happening, and a null arena or element size of zero
+leaves the array unusable.
+
+Parameters:
+  Arena_Array *array        |    The array being set up.
+  Arena *arena              |    The arena the array is
+                                 allocated from.
+  size_t element_size       |    The size (in bytes) of each
+                                 element.
+  unsigned int alignment    |    Alignment (in bytes) of the
+                                 elements.
+*/
+void arena_array_init(Arena_Array *array, Arena *arena, size_t element_size, unsigned int alignment);
+
+
+/*
+Make room for count more elements past the array's count,
+growing its storage with arena_realloc_aligned to at
+least double its capacity if they do not fit. The count
+itself is left as it is. Passing a null array, a count of
+zero, a size that overflows, or a failure to grow will all
+result in returning NULL.
+
+Parameters:
+  Arena_Array *array    |    The array making room.
+  size_t count          |    The number of elements that
+                             must fit.
+Return:
+  Pointer to the first free element on success, NULL on
+  failure.
+*/
+void* arena_array_reserve(Arena_Array *array, size_t count);
+
+
+/*
+Append count elements to the array in one go, copied from
+elements, or left for the caller to fill in if elements is
+null. Pointers into the array are invalidated if it has to
+move. Passing a null array, a count of zero, or a failure
+to grow will all result in returning NULL.
+
+Parameters:
+  Arena_Array *array      |    The array being appended to.
+  const void *elements    |    The elements being appended,
+                               or NULL.
+  size_t count            |    The number of elements.
+Return:
+  Pointer to the first appended element on success, NULL
+  on failure.
+*/
+void* arena_array_append(Arena_Array *array, const void *elements, size_t count);
+
+
+/*
+Finish the array, giving its unused capacity back to the
+arena if its storage is still the most recent allocation,
+and leave it empty so that appending starts new storage
+without touching the finished one. Passing a null array
+results in an empty slice.
+
+Parameters:
+  Arena_Array *array    |    The array being finished.
+Return:
+  The array's elements and their count.
+*/
+Arena_Slice arena_array_freeze(Arena_Array *array);
+
+
+/*
+Set up an empty string builder. Nothing is allocated until
+the first append. Passing a null string results in nothing
+happening, and a null arena leaves the string unusable.
+
+Parameters:
+  Arena_String *string    |    The string being set up.
+  Arena *arena            |    The arena the string is
+                               allocated from.
+*/
+void arena_string_init(Arena_String *string, Arena *arena);
+
+
+/*
+Make room for length more chars past the string's length,
+plus its NUL terminator, growing it like
+arena_array_reserve. Passing a null string, a size that
+overflows, or a failure to grow will all result in
+returning NULL.
+
+Parameters:
+  Arena_String *string    |    The string making room.
+  size_t length           |    The number of chars that
+                               must fit.
+Return:
+  Pointer to the string's terminator on success, NULL on
+  failure.
+*/
+char* arena_string_reserve(Arena_String *string, size_t length);
+
+
+/*
+Append length chars of text to the string, which need not
+be NUL terminated. Passing a null string or text, or a
+failure to grow, will all result in returning NULL, with
+the string left as it was.
+
+Parameters:
+  Arena_String *string    |    The string being appended
+                               to.
+  const char *text        |    The chars being appended.
+  size_t length           |    The number of chars.
+Return:
+  The whole NUL terminated string on success, NULL on
+  failure.
+*/
+char* arena_string_append(Arena_String *string, const char *text, size_t length);
+
+
+#ifdef ARENA_HAS_FORMAT
+
+/*
+Append text formatted like printf to the string. It is
+formatted straight into the string's spare capacity, and
+only formatted a second time if it has to grow. Only
+available when compiling for C99 or C++11 or later, in
+which case ARENA_HAS_FORMAT is defined. Passing a null
+string or format, a failed format, or a failure to grow
+will all result in returning NULL, with the string left as
+it was.
+
+Parameters:
+  Arena_String *string    |    The string being appended
+                               to.
+  const char *format      |    The printf format.
+  ...                     |    The values being formatted.
+Return:
+  The whole NUL terminated string on success, NULL on
+  failure.
+*/
+char* arena_string_appendf(Arena_String *string, const char *format, ...);
+
+#endif /* ARENA_HAS_FORMAT */
+
+
+/*
+Finish the string like arena_array_freeze. The slice's
+data stays NUL terminated, and its count does not include
+the terminator. Passing a null string results in an empty
+slice.
+
+Parameters:
+  Arena_String *string    |    The string being finished.
+Return:
+  The string's chars and its length.
+*/
+Arena_Slice arena_string_freeze(Arena_String *string);
+
+
+#ifdef ARENA_HAS_ATOMICS
+
+/*
+Allocate and return a pointer to a concurrent arena with a
+region of the specified size. The arena and its region are
+a single allocation. Providing a size of zero results in a
+failure.
+
+Parameters:
+  size_t size    |    The size (in bytes) of the arena
+                      memory region.
+Return:
+  Pointer to arena on success, NULL on failure
+*/
+Arena_Concurrent* arena_concurrent_create(size_t size);
+
+
+/*
+Same as arena_alloc, except that it is safe to call from
+any number of threads at once. The size is rounded up to a
+multiple of ARENA_DEFAULT_ALIGNMENT and the index is
+bumped with a compare-and-swap loop, so it is left alone
+when the allocation does not fit. Providing a size of zero
+results in a failure.
+
+Parameters:
+  Arena_Concurrent *arena    |    The arena being allocated
+                                  from.
+  size_t size                |    The size (in bytes) of the
+                                  allocation.
+Return:
+  Pointer to arena region segment on success, NULL on
+  failure.
+*/
+void* arena_concurrent_alloc(Arena_Concurrent *arena, size_t size);
+
+
+/*
+Same as arena_alloc_aligned, except that it is safe to
+call from any number of threads at once. The index is
+bumped with a compare-and-swap loop, since the padding
+depends on where the index is when the allocation is
+made. Providing a size of zero results in a failure.
+
+Parameters:
+  Arena_Concurrent *arena    |    The arena being allocated
+                                  from.
+  size_t size                |    The size (in bytes) of the
+                                  allocation.
+  unsigned int alignment     |    Alignment (in bytes) of the
+                                  allocation.
+Return:
+  Pointer to arena region segment on success, NULL on
+  failure.
+*/
+void* arena_concurrent_alloc_aligned(Arena_Concurrent *arena, size_t size, unsigned int alignment);
+
+
+/*
+Reset the concurrent arena's index to the beginning of its
+region. Every Arena_Local using the arena as its parent
+drops its chunk on its next allocation. This must not race
+with allocations from other threads.
+
+Parameters:
+  Arena_Concurrent *arena    |    The arena to be cleared.
+*/
+void arena_concurrent_clear(Arena_Concurrent *arena);
+
+
+/*
+Free the concurrent arena and its region. This must not
+race with allocations from other threads.
+
+Parameters:
+  Arena_Concurrent *arena    |    The arena to be destroyed.
+*/
+void arena_concurrent_destroy(Arena_Concurrent *arena);
+
+
+/*
+Set up a per-thread front end that carves chunks of
+chunk_size bytes out of parent. No memory is taken from
+the parent until the first allocation. Passing a null
+local or parent, or a chunk size of zero, leaves the
+local unusable, and allocations from it fail.
+
+Parameters:
+  Arena_Local *local            |    The front end being set
+                                     up.
+  Arena_Concurrent *parent      |    The shared arena chunks
+                                     are carved from.
+  size_t chunk_size             |    The size (in bytes) of
+                                     each chunk.
+*/
+void arena_local_init(Arena_Local *local, Arena_Concurrent *parent, size_t chunk_size);
+
+
+/*
+Same as arena_alloc, but for a per-thread front end. Only
+the thread owning local may call this. Allocations larger
+than half the chunk size are made from the parent
+directly, so they do not throw away the rest of the
+current chunk. Providing a size of zero results in a
+failure.
+
+Parameters:
+  Arena_Local *local    |    The front end being allocated
+                             from.
+  size_t size           |    The size (in bytes) of the
+                             allocation.
+Return:
+  Pointer to arena region segment on success, NULL on
+  failure.
+*/
+void* arena_local_alloc(Arena_Local *local, size_t size);
+
+
+/*
+Same as arena_alloc_aligned, but for a per-thread front
+end. Only the thread owning local may call this.
+Providing a size of zero results in a failure.
+
+Parameters:
+  Arena_Local *local        |    The front end being
+                                 allocated from.
+  size_t size               |    The size (in bytes) of the
+                                 allocation.
+  unsigned int alignment    |    Alignment (in bytes) of the
+                                 allocation.
+Return:
+  Pointer to arena region segment on success, NULL on
+  failure.
+*/
+void* arena_local_alloc_aligned(Arena_Local *local, size_t size, unsigned int alignment);
+
+
+/*
+Create a concurrent arena with a region of the specified
+size for each NUMA node, bound to its node. Where binding
+is not possible the regions are left untouched, so they
+are placed on the node of whichever thread first uses
+them. Providing a size of zero, or a failure to allocate
+any of the arenas, results in returning NULL.
+
+Parameters:
+  size_t size    |    The size (in bytes) of each node's
+                      region.
+Return:
+  Pointer to the set of arenas on success, NULL on failure.
+*/
+Arena_Nodes* arena_nodes_create(size_t size);
+
+
+/*
+Return the concurrent arena for the calling thread's NUMA
+node, to allocate from or to hand to arena_local_init.
+Passing null nodes results in returning NULL.
+
+Parameters:
+  Arena_Nodes *nodes    |    The set of arenas.
+Return:
+  The arena of the caller's node, NULL on failure.
+*/
+Arena_Concurrent* arena_nodes_local(Arena_Nodes *nodes);
+
+
+/*
+Same as arena_concurrent_alloc, from the arena of the
+calling thread's NUMA node. Providing a size of zero
+results in a failure.
+
+Parameters:
+  Arena_Nodes *nodes    |    The set of arenas being
+                             allocated from.
+  size_t size           |    The size (in bytes) of the
+                             allocation.
+Return:
+  Pointer to arena region segment on success, NULL on
+  failure.
+*/
+void* arena_nodes_alloc(Arena_Nodes *nodes, size_t size);
+
+
+/*
+Free the memory of every arena in the set, and the set
+itself. Passing null nodes results in nothing happening.
+
+Parameters:
+  Arena_Nodes *nodes    |    The set of arenas being
+                             destroyed.
+*/
+void arena_nodes_destroy(Arena_Nodes *nodes);
+
+#endif /* ARENA_HAS_ATOMICS */
+
+
+#ifdef ARENA_TRACE_LOCATION
+
+/*
+The functions that the wrapper macros at the end of this
+header call in place of arena_alloc, arena_alloc_aligned,
+arena_calloc, arena_calloc_aligned, arena_expand,
+arena_clear and arena_destroy when ARENA_TRACE_LOCATION is
+defined. Each does the same as the function it replaces,
+then passes file and line on to ARENA_TRACE. Allocations
+made inside the library, such as by pools, are not traced
+in this mode. Batches, reallocs and growth are still
+traced, with a NULL file.
+
+Parameters:
+  const char *file    |    The file the call was made from.
+  int line            |    The line the call was made from.
+*/
+void* arena_alloc_at(Arena *arena, size_t size, const char *file, int line);
+void* arena_alloc_aligned_at(Arena *arena, size_t size, unsigned int alignment, const char *file, int line);
+void* arena_calloc_at(Arena *arena, size_t count, size_t size, const char *file, int line);
+void* arena_calloc_aligned_at(Arena *arena, size_t count, size_t size, unsigned int alignment,
+                              const char *file, int line);
+Arena* arena_expand_at(Arena *arena, size_t size, const char *file, int line);
+void arena_clear_at(Arena *arena, const char *file, int line);
+void arena_destroy_at(Arena *arena, const char *file, int line);
+
+#endif /* ARENA_TRACE_LOCATION */
+
+
+#ifdef ARENA_STATS
+
+/*
+Set all of the arena's statistics back to zero, so that a
+new phase of its use can be measured on its own. Passing a
+null arena results in nothing happening.
+
+Parameters:
+  Arena *arena    |    The arena whose statistics are
+                       being reset.
+*/
+void arena_reset_stats(Arena *arena);
+
+#endif /* ARENA_STATS */
+
+
+#ifdef ARENA_GUARD
+
+/*
+Guard the arena from now on. Every allocation is followed
+by ARENA_GUARD_SIZE canary bytes and the offset of the
+allocation before it, so that arena_clear and
+arena_destroy can walk back through the allocations and
+call ARENA_GUARD_FAIL on the first overwritten canary,
+without keeping a list like ARENA_DEBUG does. Released
+memory is filled with ARENA_POISON_BYTE, or zeroed for
+arenas kept zeroed, and under AddressSanitizer everything
+past the index is poisoned, so reads and writes of memory
+that was never allocated or has been released are
+reported where they happen. Guarded arenas must not be
+the destination of arena_copy or arena_copy_delta, and
+arenas over a buffer must be destroyed before the buffer
+goes away. Does nothing unless the arena is empty, has no
+chained blocks and was not made by arena_map. Passing a
+null arena results in nothing happening.
+
+Parameters:
+  Arena *arena    |    The arena being guarded.
+*/
+void arena_guard(Arena *arena);
+
+
+/*
+The allocation behind arena_alloc_aligned for guarded
+arenas, laying out the allocation, its canary and the
+offset of the allocation before it. Chained and virtual
+arenas grow as usual.
+
+Parameters:
+  Arena *arena              |    The arena being allocated
+                                 from.
+  size_t size               |    The size (in bytes) of the
+                                 allocation.
+  unsigned int alignment    |    Alignment (in bytes) of the
+                                 allocation.
+Return:
+  Pointer to arena region segment on success, NULL on
+  failure.
+*/
+void* arena_guard_alloc(Arena *arena, size_t size, unsigned int alignment);
+
+
+/*
+Check every canary in the guarded arena, in every chained
+block, from the most recent allocation back. Takes O(n)
+time in the number of allocations. Passing a null or
+unguarded arena results in returning NULL.
+
+Parameters:
+  Arena *arena    |    The arena being checked.
+Return:
+  Pointer to the first overwritten canary found, just past
+  the allocation that ran over it, or NULL if all are intact.
+*/
+void* arena_guard_check(Arena *arena);
+
+
+/*
+Release the guarded arena's current block from index up,
+filling it with ARENA_POISON_BYTE and poisoning it for
+AddressSanitizer. Called by arena_clear and arena_rewind.
+Passing a null or unguarded arena, or an index past the
+arena's, results in nothing happening.
+
+Parameters:
+  Arena *arena    |    The arena whose memory is being
+                       released.
+  size_t index    |    Where the released memory starts.
+*/
+void arena_guard_poison(Arena *arena, size_t index);
+
+#endif /* ARENA_GUARD */
+
+
+#ifdef ARENA_DEBUG
+
+/*
+Returns a pointer to the allocation struct associated
+with a pointer to a segment in the specified arena's
+region. Takes O(log n) time in the number of allocations.
+
+Parameters:
+  Arena *arena    |    The arena whose region should
+                       have a portion pointed to by
+                       ptr.
+  void *ptr       |    The ptr being searched for
+                       within the arena in order to
+                       find an allocation struct
+                       associated with it.
+*/
+Arena_Allocation* arena_get_allocation_struct(Arena *arena, void *ptr);
+
+
+/*
+Adds an arena allocation to the arena's linked list of
+allocations under debug. Takes O(1) time, and allocates
+memory for the list only once every
+ARENA_ALLOCATION_CHUNK allocations.
+
+Parameters:
+  Arena *arena    |    The arena whose allocation list
+                       should be added to
+  size_t size     |    The size of the allocation being
+                       added.
+*/
+void arena_add_allocation(Arena *arena, size_t size);
+
+
+/*
+Drops every allocation struct after the first allocations
+of them under debug, for when the memory they describe has
+been released. The chunks are kept, so adding allocations
+again does not have to allocate them. Called by
+arena_rewind and arena_pop_block.
+
+Parameters:
+  Arena *arena                |    The arena whose allocation
+                                   list is being trimmed.
+  unsigned long allocations   |    The number of allocation
+                                   structs to keep.
+*/
+void arena_trim_allocation_list(Arena *arena, unsigned long allocations);
+
+
+/*
+Deletes the arena's linked list of allocations under
+debug.
+
+Parameters:
+  Arena *arena    |    The arena whose allocation list
+                       is being deleted.
+*/
+void arena_delete_allocation_list(Arena *arena);
+
+#endif /* ARENA_DEBUG */
+
+
+/*
+The hot path. Normally compiled only into the implementation,
+but with ARENA_INLINE_HOT_PATH every includer gets its own
+static inline copy, so calls can be inlined without LTO.
+*/
+#if defined(ARENA_IMPLEMENTATION) || defined(ARENA_INLINE_HOT_PATH)
+
+
+ARENA_INLINE void* arena_alloc(Arena *arena, size_t size)
+{
+    #if !defined(ARENA_DEBUG) && !defined(ARENA_GUARD)
+    /* Duplicated from arena_alloc_aligned so the default alignment is a constant */
+    if (size != 0 && arena != NULL && arena->region != NULL)
+    {
+        size_t offset = ARENA_ALIGN_PADDING(arena->region + arena->index, ARENA_DEFAULT_ALIGNMENT);
+
+        if (arena->size - arena->index >= offset && arena->size - arena->index - offset >= size)
+        {
+            arena->index += offset + size;
+
+            #ifdef ARENA_STATS
+            ARENA_STATS_RECORD(arena, size, offset);
+            #endif /* ARENA_STATS */
+
+            ARENA_TRACE_EVENT(ARENA_EVENT_ALLOC, arena, arena->region + (arena->index - size), size,
+                              ARENA_DEFAULT_ALIGNMENT);
+            return arena->region + (arena->index - size);
+        }
+    }
+    #endif /* !ARENA_DEBUG && !ARENA_GUARD */
+
+    /* Failures, growth and bookkeeping are all left to the general path */
+    return arena_alloc_aligned(arena, size, ARENA_DEFAULT_ALIGNMENT);
+}
+
+
+ARENA_INLINE void* arena_alloc_aligned(Arena *arena, size_t size, unsigned int alignment)
+{
+    size_t offset;
+
+    if (size == 0)
+    {
+        return NULL;
+    }
+
+    if (arena == NULL || arena->region == NULL)
+    {
+        return NULL;
+    }
+
+    #ifdef ARENA_GUARD
+    if (arena->flags & ARENA_FLAG_GUARD)
+    {
+        return arena_guard_alloc(arena, size, alignment);
+    }
+    #endif /* ARENA_GUARD */
+
+    offset = ARENA_ALIGN_PADDING(arena->region + arena->index, alignment);
+
+    /* The index is left untouched until we know the allocation fits */
+    if (arena->size - arena->index < offset || arena->size - arena->index - offset < size)
+    {
+        return arena_alloc_grow(arena, size, alignment);
+    }
+
+    arena->index += offset;
+
+    #ifdef ARENA_DEBUG
+    arena_add_allocation(arena, size);
+    #endif /* ARENA_DEBUG */
+
+    arena->index += size;
+
+    #ifdef ARENA_STATS
+    ARENA_STATS_RECORD(arena, size, offset);
+    #endif /* ARENA_STATS */
+
+    ARENA_TRACE_EVENT(ARENA_EVENT_ALLOC, arena, arena->region + (arena->index - size), size, alignment);
+    return arena->region + (arena->index - size);
+}
+
+
+ARENA_INLINE void* arena_alloc_simd(Arena *arena, size_t size)
+{
+    return arena_alloc_aligned(arena, size, ARENA_SIMD_ALIGNMENT);
+}
+
+
+ARENA_INLINE void* arena_alloc_cache_line(Arena *arena, size_t size)
+{
+    if (size > (size_t)-1 - ARENA_CACHE_LINE_SIZE)
+    {
+        return NULL;
+    }
+
+    return arena_alloc_aligned(arena, size + ARENA_ALIGN_PADDING(size, ARENA_CACHE_LINE_SIZE),
+                               ARENA_CACHE_LINE_SIZE);
+}
+
+
+ARENA_INLINE void* arena_fixed_alloc(char *region, size_t *index, size_t capacity, size_t size,
+                                     unsigned int alignment)
+{
+    size_t offset;
+
+    if (size == 0 || region == NULL || index == NULL)
+    {
+        return NULL;
+    }
+
+    offset = ARENA_ALIGN_PADDING(region + *index, alignment);
+    if (capacity - *index < offset || capacity - *index - offset < size)
+    {
+        return NULL;
+    }
+
+    *index += offset + size;
+    return region + (*index - size);
+}
+
+
+ARENA_INLINE void arena_clear(Arena *arena)
+{
+    #ifdef ARENA_GUARD
+    void *damaged;
+    #endif /* ARENA_GUARD */
+
+    if (arena == NULL)
+    {
+        return;
+    }
+
+    /* Zeroing or poisoning the region would write to read-only pages */
+    if (ARENA_READ_ONLY(arena))
+    {
+        #ifdef ARENA_GUARD
+        ARENA_GUARD_FAIL(arena, arena->region);
+        #endif /* ARENA_GUARD */
+        return;
+    }
+
+    ARENA_TRACE_EVENT(ARENA_EVENT_CLEAR, arena, arena->region, arena->index, 0);
+
+    #ifdef ARENA_GUARD
+    if ((arena->flags & ARENA_FLAG_GUARD) && (damaged = arena_guard_check(arena)) != NULL)
+    {
+        ARENA_GUARD_FAIL(arena, damaged);
+    }
+    #endif /* ARENA_GUARD */
+
+    while (arena->blocks != NULL)
+    {
+        arena_pop_block(arena);
+    }
+
+    if (arena->flags & ARENA_FLAG_ZERO)
+    {
+        arena_zero_used(arena);
+    }
+
+    #ifdef ARENA_GUARD
+    arena_guard_poison(arena, 0);
+    #endif /* ARENA_GUARD */
+
+    arena->index = 0;
+    arena->dirty = 0;
+    arena->generation++;
+
+    if (arena->flags & ARENA_FLAG_DECOMMIT)
+    {
+        arena_decommit(arena);
+    }
+
+    #ifdef ARENA_DEBUG
+    arena_delete_allocation_list(arena);
+    #endif /* ARENA_DEBUG */
+}
+
+
+#endif /* ARENA_IMPLEMENTATION || ARENA_INLINE_HOT_PATH */
+
+
+#ifdef __cplusplus
+}
+#endif
+
+
+#ifdef ARENA_IMPLEMENTATION
+
+
+#ifndef ARENA_MALLOC
+    #include <stdlib.h>
+    #define ARENA_MALLOC malloc
+#endif /* !ARENA_MALLOC */
+
+#ifndef ARENA_FREE
+    #include <stdlib.h>
+    #define ARENA_FREE free
+#endif /* !ARENA_FREE */
+
+#ifndef ARENA_REALLOC
+    #include <stdlib.h>
+    #define ARENA_REALLOC realloc
+#endif
+
+#ifndef ARENA_MEMCPY
+    #include <string.h>
+    #define ARENA_MEMCPY memcpy
+#endif /* !ARENA_MEMCPY */
+
+#ifndef ARENA_MEMSET
+    #include <string.h>
+    #define ARENA_MEMSET memset
+#endif /* !ARENA_MEMSET */
+
+#ifndef ARENA_MEMCMP
+    #include <string.h>
+    #define ARENA_MEMCMP memcmp
+#endif /* !ARENA_MEMCMP */
+
+#ifdef ARENA_HAS_FORMAT
+    #include <stdarg.h>
+#endif /* ARENA_HAS_FORMAT */
+
+#ifdef ARENA_GUARD
+    #ifndef ARENA_GUARD_SIZE
+        #define ARENA_GUARD_SIZE 8
+    #endif
+    #ifndef ARENA_GUARD_BYTE
+        #define ARENA_GUARD_BYTE 0xAB
+    #endif
+    #ifndef ARENA_POISON_BYTE
+        #define ARENA_POISON_BYTE 0xDD
+    #endif
+    /* The canary and the offset of the allocation before it */
+    #define ARENA_GUARD_OVERHEAD (ARENA_GUARD_SIZE + sizeof(size_t))
+
+    #if defined(__SANITIZE_ADDRESS__)
+        #define ARENA_ASAN
+    #elif defined(__has_feature)
+        #if __has_feature(address_sanitizer)
+            #define ARENA_ASAN
+        #endif
+    #endif
+
+    #ifdef ARENA_ASAN
+        #include <sanitizer/asan_interface.h>
+        #define ARENA_ASAN_POISON(address, size) ASAN_POISON_MEMORY_REGION(address, size)
+        #define ARENA_ASAN_UNPOISON(address, size) ASAN_UNPOISON_MEMORY_REGION(address, size)
+    #else
+        #define ARENA_ASAN_POISON(address, size) ((void)(address), (void)(size))
+        #define ARENA_ASAN_UNPOISON(address, size) ((void)(address), (void)(size))
+    #endif /* ARENA_ASAN */
+#endif /* ARENA_GUARD */
+
+#if defined(_WIN32)
+    #ifndef WIN32_LEAN_AND_MEAN
+        #define WIN32_LEAN_AND_MEAN
+    #endif
+    #include <windows.h>
+    #define ARENA_VIRTUAL_WINDOWS
+#elif defined(__unix__) || defined(__APPLE__)
+    #include <sys/mman.h>
+    #if defined(MAP_ANONYMOUS) || defined(MAP_ANON)
+        #define ARENA_VIRTUAL_POSIX
+        #ifndef MAP_ANONYMOUS
+            #define MAP_ANONYMOUS MAP_ANON
+        #endif
+        #ifndef MAP_NORESERVE
+            #define MAP_NORESERVE 0
+        #endif
+    #endif
+#endif
+
+#include <stdio.h>
+
+#ifdef ARENA_VIRTUAL_POSIX
+    #include <fcntl.h>
+    #include <sys/stat.h>
+    #include <unistd.h>
+#endif /* ARENA_VIRTUAL_POSIX */
+
+/* There are no libc wrappers for these without libnuma, so the system calls are made directly */
+#if defined(__linux__) && defined(ARENA_VIRTUAL_POSIX)
+    #include <sys/syscall.h>
+    #if defined(SYS_mbind) && defined(SYS_get_mempolicy) && defined(SYS_getcpu)
+        #define ARENA_NUMA_LINUX
+        #define ARENA_MPOL_PREFERRED 1
+        #define ARENA_MPOL_MF_MOVE 0x2u
+        #define ARENA_MPOL_F_MEMS_ALLOWED 0x4ul
+        #define ARENA_NODE_MASK_BITS (sizeof(unsigned long) * 8)
+        #define ARENA_NODE_MASK_WORDS ((ARENA_MAX_NODES + ARENA_NODE_MASK_BITS - 1) / ARENA_NODE_MASK_BITS)
+    #endif
+#endif
+
+#define ARENA_IMAGE_MAGIC "ARENAIMG"
+
+/* Mapped arenas keep their file open after the header, so that arena_fork can map it again */
+#define ARENA_MAPPED_FILE(arena) (*(int *)((arena) + 1))
+
+/* The mapping starts a page before the page the region starts in */
+#define ARENA_MAPPED_BASE(arena) \
+    ((arena)->region - (size_t)(arena)->region % ARENA_IMAGE_ALIGNMENT - ARENA_IMAGE_ALIGNMENT)
+
+#define ARENA_COMMIT_STEP(arena) \
+    ((arena)->flags & ARENA_FLAG_HUGE_PAGES ? (size_t)ARENA_HUGE_PAGE_SIZE : (size_t)ARENA_COMMIT_SIZE)
+
+
+/* Sets every field of a new arena, so that a field added later only has to be set here */
+static void arena_init_fields(Arena *arena, char *region, size_t size, unsigned int flags, size_t reserved)
+{
+    arena->region = region;
+    arena->index = 0;
+    arena->size = size;
+
+    arena->blocks = NULL;
+    arena->growth = 0;
+    arena->flags = flags;
+    arena->generation = 0;
+    arena->reserved = reserved;
+    arena->dirty = 0;
+    arena->growth_limit = 0;
+    arena->growth_step = size;
+
+    #ifdef ARENA_STATS
+    arena_reset_stats(arena);
+    #endif /* ARENA_STATS */
+
+    #ifdef ARENA_DEBUG
+    arena->head_allocation = NULL;
+    arena->allocations = 0;
+    arena->allocation_chunks = NULL;
+    arena->allocation_chunk_count = 0;
+    #endif /* ARENA_DEBUG */
+}
+
+
+Arena* arena_create(size_t size)
+{
+    Arena *arena;
+
+    if (size == 0)
+    {
+        return NULL;
+    }
+
+    /* A malloc of 0 is implementation defined, so the above check is necessary */
+    arena = ARENA_MALLOC(sizeof(Arena));
+    if (arena == NULL)
+    {
+        return NULL;
+    }
+
+    arena->region = ARENA_MALLOC(size);
+    if (arena->region == NULL)
+    {
+        ARENA_FREE(arena);
+        return NULL;
+    }
+
+    arena_init_fields(arena, arena->region, size, ARENA_FLAG_FREE_REGION | ARENA_FLAG_FREE_ARENA, 0);
+
+    return arena;
+}
+
+
+Arena* arena_create_chained(size_t size, unsigned int growth)
+{
+    Arena *arena;
+
+    if (growth == 0)
+    {
+        return NULL;
+    }
+
+    arena = arena_create(size);
+    if (arena == NULL)
+    {
+        return NULL;
+    }
+
+    arena->growth = growth;
+    return arena;
+}
+
+
+Arena* arena_create_inline(size_t size)
+{
+    Arena *arena;
+
+    if (size == 0 || size > (size_t)-1 - sizeof(Arena))
+    {
+        return NULL;
+    }
+
+    arena = ARENA_MALLOC(sizeof(Arena) + size);
+    if (arena == NULL)
+    {
+        return NULL;
+    }
+
+    arena_init_fields(arena, (char *)(arena + 1), size, ARENA_FLAG_FREE_ARENA, 0);
+
+    return arena;
+}
+
+
+Arena* arena_create_from_buffer(void *buffer, size_t size)
+{
+    Arena *arena;
+    size_t offset;
+
+    if (buffer == NULL)
+    {
+        return NULL;
+    }
+
+    offset = (size_t)buffer % ARENA_ALIGNOF(Arena);
+    if (offset > 0)
+    {
+        offset = ARENA_ALIGNOF(Arena) - offset;
+    }
+
+    if (size <= offset || size - offset <= sizeof(Arena))
+    {
+        return NULL;
+    }
+
+    arena = (Arena *)((char *)buffer + offset);
+    arena_init_fields(arena, (char *)(arena + 1), size - offset - sizeof(Arena), 0, 0);
+
+    return arena;
+}
+
+
+Arena* arena_create_virtual(size_t reserve, unsigned int flags)
+{
+    Arena *arena;
+    char *base;
+    size_t step;
+
+    step = flags & ARENA_FLAG_HUGE_PAGES ? (size_t)ARENA_HUGE_PAGE_SIZE : (size_t)ARENA_COMMIT_SIZE;
+    if (reserve == 0 || reserve > (size_t)-1 - sizeof(Arena) - 2 * step)
+    {
+        return NULL;
+    }
+
+    reserve = (reserve + sizeof(Arena) + step - 1) / step * step;
+
+    #if defined(ARENA_VIRTUAL_POSIX)
+    {
+        char *mapping;
+        size_t padding;
+
+        /* Over-reserve by a step so that commit steps line up with huge pages */
+        mapping = mmap(NULL, reserve + step, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+        if (mapping == MAP_FAILED)
+        {
+            return NULL;
+        }
+
+        padding = ARENA_ALIGN_PADDING(mapping, step);
+        base = mapping + padding;
+        if (padding > 0)
+        {
+            munmap(mapping, padding);
+        }
+        munmap(base + reserve, step - padding);
+
+        #ifdef MADV_HUGEPAGE
+        if (flags & ARENA_FLAG_HUGE_PAGES)
+        {
+            madvise(base, reserve, MADV_HUGEPAGE);
+        }
+        #endif /* MADV_HUGEPAGE */
+
+        if (mprotect(base, step, PROT_READ | PROT_WRITE) != 0)
+        {
+            munmap(base, reserve);
+            return NULL;
+        }
+    }
+    #elif defined(ARENA_VIRTUAL_WINDOWS)
+    base = VirtualAlloc(NULL, reserve, MEM_RESERVE, PAGE_NOACCESS);
+    if (base == NULL)
+    {
+        return NULL;
+    }
+
+    if (VirtualAlloc(base, step, MEM_COMMIT, PAGE_READWRITE) == NULL)
+    {
+        VirtualFree(base, 0, MEM_RELEASE);
+        return NULL;
+    }
+    #else
+    base = NULL;
+    #endif
+
+    if (base == NULL)
+    {
+        return NULL;
+    }
+
+    arena = (Arena *)base;
+    arena_init_fields(arena, (char *)(arena + 1), step - sizeof(Arena),
+                      ARENA_FLAG_VIRTUAL | (flags & (ARENA_FLAG_HUGE_PAGES | ARENA_FLAG_DECOMMIT | ARENA_FLAG_ZERO)),
+                      reserve);
+
+    /* Blocks are only chained once the whole reservation is committed */
+    arena->growth_step = reserve - sizeof(Arena);
+
+    return arena;
+}
+
+
+Arena* arena_commit(Arena *arena, size_t size)
+{
+    size_t committed;
+    size_t target;
+    size_t step;
+
+    if (arena == NULL || !(arena->flags & ARENA_FLAG_VIRTUAL) || arena->blocks != NULL)
+    {
+        return NULL;
+    }
+
+    if (size <= arena->size)
+    {
+        return arena;
+    }
+
+    if (size > arena->reserved - sizeof(Arena))
+    {
+        return NULL;
+    }
+
+    step = ARENA_COMMIT_STEP(arena);
+    committed = sizeof(Arena) + arena->size;
+    target = (sizeof(Arena) + size + step - 1) / step * step;
+
+    #if defined(ARENA_VIRTUAL_POSIX)
+    if (mprotect((char *)arena + committed, target - committed, PROT_READ | PROT_WRITE) != 0)
+    {
+        return NULL;
+    }
+    #elif defined(ARENA_VIRTUAL_WINDOWS)
+    if (VirtualAlloc((char *)arena + committed, target - committed, MEM_COMMIT, PAGE_READWRITE) == NULL)
+    {
+        return NULL;
+    }
+    #else
+    (void)committed;
+    return NULL;
+    #endif
+
+    arena->size = target - sizeof(Arena);
+
+    #ifdef ARENA_STATS
+    arena->stats.expansions++;
+    #endif /* ARENA_STATS */
+
+    return arena;
+}
+
+
+void arena_decommit(Arena *arena)
+{
+    size_t committed;
+    size_t step;
+
+    if (arena == NULL || !(arena->flags & ARENA_FLAG_VIRTUAL) || arena->blocks != NULL || arena->index != 0)
+    {
+        return;
+    }
+
+    step = ARENA_COMMIT_STEP(arena);
+    committed = sizeof(Arena) + arena->size;
+    if (committed <= step)
+    {
+        return;
+    }
+
+    #if defined(ARENA_VIRTUAL_POSIX)
+    #ifdef MADV_DONTNEED
+    madvise((char *)arena + step, committed - step, MADV_DONTNEED);
+    #endif /* MADV_DONTNEED */
+    if (mprotect((char *)arena + step, committed - step, PROT_NONE) != 0)
+    {
+        return;
+    }
+    #elif defined(ARENA_VIRTUAL_WINDOWS)
+    if (!VirtualFree((char *)arena + step, committed - step, MEM_DECOMMIT))
+    {
+        return;
+    }
+    #else
+    return;
+    #endif
+
+    arena->size = step - sizeof(Arena);
+}
+
+
+int arena_current_node(void)
+{
+    #ifdef ARENA_NUMA_LINUX
+    unsigned int cpu;
+    unsigned int node;
+
+    if (syscall(SYS_getcpu, &cpu, &node, NULL) == 0 && node < ARENA_MAX_NODES)
+    {
+        return (int)node;
+    }
+    #endif /* ARENA_NUMA_LINUX */
+
+    return 0;
+}
+
+
+int arena_node_count(void)
+{
+    #ifdef ARENA_NUMA_LINUX
+    unsigned long mask[ARENA_NODE_MASK_WORDS];
+    int count = 0;
+    int node;
+
+    /* The kernel reads one bit less of the mask than it is told to, here and in mbind */
+    ARENA_MEMSET(mask, 0, sizeof(mask));
+    if (syscall(SYS_get_mempolicy, NULL, mask, (unsigned long)ARENA_MAX_NODES + 1, NULL,
+                ARENA_MPOL_F_MEMS_ALLOWED) == 0)
+    {
+        for (node = 0; node < ARENA_MAX_NODES; node++)
+        {
+            if (mask[node / ARENA_NODE_MASK_BITS] & (1ul << (node % ARENA_NODE_MASK_BITS)))
+            {
+                count = node + 1;
+            }
+        }
+    }
+
+    if (count != 0)
+    {
+        return count;
+    }
+    #endif /* ARENA_NUMA_LINUX */
+
+    return 1;
+}
+
+
+void* arena_bind_memory(void *memory, size_t size, int node)
+{
+    #ifdef ARENA_NUMA_LINUX
+    unsigned long mask[ARENA_NODE_MASK_WORDS];
+    size_t page;
+    char *start;
+    char *end;
+
+    if (memory == NULL || size == 0 || node < 0 || node >= ARENA_MAX_NODES)
+    {
+        return NULL;
+    }
+
+    /* Only whole pages can be bound, the partial ones at each end may be shared with other memory */
+    page = (size_t)sysconf(_SC_PAGESIZE);
+    start = (char *)memory + ARENA_ALIGN_PADDING(memory, page);
+    end = (char *)memory + size;
+    end -= (size_t)end % page;
+    if (end <= start)
+    {
+        return memory;
+    }
+
+    ARENA_MEMSET(mask, 0, sizeof(mask));
+    mask[node / ARENA_NODE_MASK_BITS] = 1ul << (node % ARENA_NODE_MASK_BITS);
+
+    if (syscall(SYS_mbind, start, (size_t)(end - start), ARENA_MPOL_PREFERRED, mask,
+                (unsigned long)ARENA_MAX_NODES + 1, ARENA_MPOL_MF_MOVE) != 0)
+    {
+        return NULL;
+    }
+
+    return memory;
+    #else
+    (void)memory;
+    (void)size;
+    (void)node;
+    return NULL;
+    #endif /* ARENA_NUMA_LINUX */
+}
+
+
+Arena* arena_bind_node(Arena *arena, int node)
+{
+    void *bound;
+
+    if (arena == NULL)
+    {
+        return NULL;
+    }
+
+    if (arena->flags & ARENA_FLAG_VIRTUAL)
+    {
+        bound = arena_bind_memory(arena, arena->reserved, node);
+    }
+    else
+    {
+        bound = arena_bind_memory(arena->region, arena->size, node);
+    }
+
+    return bound != NULL ? arena : NULL;
+}
+
+
+Arena* arena_expand(Arena *arena, size_t size)
+{
+    char *region;
+
+    if (arena == NULL || size <= arena->size || (arena->flags & ARENA_FLAG_MAPPED))
+    {
+        return NULL;
+    }
+
+    /* arena_commit and arena_add_block count their own growth in stats.expansions */
+    if ((arena->flags & ARENA_FLAG_VIRTUAL) && arena->blocks == NULL)
+    {
+        if (arena_commit(arena, size) == NULL)
+        {
+            return NULL;
+        }
+
+        #ifdef ARENA_GUARD
+        if (arena->flags & ARENA_FLAG_GUARD)
+        {
+            ARENA_ASAN_POISON(arena->region + arena->index, arena->size - arena->index);
+        }
+        #endif /* ARENA_GUARD */
+
+        ARENA_TRACE_EVENT(ARENA_EVENT_EXPAND, arena, arena->region, arena->size, 0);
+        return arena;
+    }
+
+    /* Moving a block would break the links and markers pointing at it */
+    if (arena->blocks != NULL)
+    {
+        return arena_add_block(arena, size);
+    }
+
+    if (arena->flags & ARENA_FLAG_FREE_REGION)
+    {
+        region = ARENA_REALLOC(arena->region, size);
+        if (region == NULL)
+        {
+            return NULL;
+        }
+    }
+    else if (arena->flags & ARENA_FLAG_FREE_ARENA)
+    {
+        /* Forks and loaded images put their region past the header, not right after it */
+        size_t header = (size_t)(arena->region - (char *)arena);
+
+        if (size > (size_t)-1 - header)
+        {
+            return NULL;
+        }
+
+        arena = ARENA_REALLOC(arena, header + size);
+        if (arena == NULL)
+        {
+            return NULL;
+        }
+
+        region = (char *)arena + header;
+    }
+    else
+    {
+        return NULL;
+    }
+
+    if (arena->flags & ARENA_FLAG_ZERO)
+    {
+        ARENA_MEMSET(region + arena->size, 0, size - arena->size);
+    }
+
+    arena->region = region;
+    arena->size = size;
+
+    #ifdef ARENA_STATS
+    arena->stats.expansions++;
+    #endif /* ARENA_STATS */
+
+    #ifdef ARENA_GUARD
+    if (arena->flags & ARENA_FLAG_GUARD)
+    {
+        ARENA_ASAN_POISON(region + arena->index, size - arena->index);
+    }
+    #endif /* ARENA_GUARD */
+
+    ARENA_TRACE_EVENT(ARENA_EVENT_EXPAND, arena, region, size, 0);
+    return arena;
+}
+
+
+Arena* arena_add_block(Arena *arena, size_t size)
+{
+    Arena_Block *block;
+    size_t next;
+
+    if (arena == NULL || size == 0)
+    {
+        return NULL;
+    }
+
+    /* Grown from the step rather than the current block, which an oversized allocation may have made huge */
+    if (arena->growth > 1 && arena->growth_step <= ((size_t)-1 - sizeof(Arena_Block)) / arena->growth)
+    {
+        next = arena->growth_step * arena->growth;
+    }
+    else
+    {
+        next = arena->growth_step;
+    }
+
+    if (arena->growth_limit != 0 && next > arena->growth_limit)
+    {
+        next = arena->growth_limit;
+    }
+
+    if (size < next)
+    {
+        size = next;
+    }
+
+    if (size > (size_t)-1 - sizeof(Arena_Block))
+    {
+        return NULL;
+    }
+
+    block = ARENA_MALLOC(sizeof(Arena_Block) + size);
+    if (block == NULL)
+    {
+        return NULL;
+    }
+
+    if (arena->flags & ARENA_FLAG_ZERO)
+    {
+        ARENA_MEMSET(block + 1, 0, size);
+    }
+
+    block->region = arena->region;
+    block->index = arena->index;
+    block->size = arena->size;
+    block->prev = arena->blocks;
+    block->growth_step = arena->growth_step;
+
+    #ifdef ARENA_DEBUG
+    block->allocations = arena->allocations;
+    #endif /* ARENA_DEBUG */
+
+    arena->growth_step = next;
+
+    arena->region = (char *)(block + 1);
+    arena->index = 0;
+    arena->size = size;
+    arena->blocks = block;
+    arena->dirty = 0;
+
+    #ifdef ARENA_STATS
+    arena->stats.expansions++;
+    #endif /* ARENA_STATS */
+
+    ARENA_TRACE_UNWRAPPED(ARENA_EVENT_EXPAND, arena, arena->region, size, 0);
+    return arena;
+}
+
+
+void arena_pop_block(Arena *arena)
+{
+    Arena_Block *block;
+
+    if (arena == NULL || arena->blocks == NULL)
+    {
+        return;
+    }
+
+    block = arena->blocks;
+    arena->region = block->region;
+    arena->index = block->index;
+    arena->size = block->size;
+    arena->blocks = block->prev;
+    arena->growth_step = block->growth_step;
+    arena->dirty = 0;
+    arena->generation++;
+
+    #ifdef ARENA_DEBUG
+    /* Records made in the block would point into freed memory */
+    arena_trim_allocation_list(arena, block->allocations);
+    #endif /* ARENA_DEBUG */
+
+    ARENA_FREE(block);
+}
+
+
+Arena* arena_set_growth(Arena *arena, unsigned int growth, size_t limit)
+{
+    if (arena == NULL || (arena->flags & ARENA_FLAG_MAPPED))
+    {
+        return NULL;
+    }
+
+    arena->growth = growth;
+    arena->growth_limit = limit;
+
+    return arena;
+}
+
+
+Arena* arena_reserve(Arena *arena, size_t size)
+{
+    if (arena == NULL || size == 0)
+    {
+        return NULL;
+    }
+
+    if (arena->size - arena->index >= size)
+    {
+        return arena;
+    }
+
+    /* Virtual arenas commit more of their reservation in place, and only chain once it runs out */
+    if ((arena->flags & ARENA_FLAG_VIRTUAL) && arena->blocks == NULL)
+    {
+        if (arena->index > (size_t)-1 - size)
+        {
+            return NULL;
+        }
+
+        if (arena_commit(arena, arena->index + size) != NULL)
+        {
+            ARENA_TRACE_UNWRAPPED(ARENA_EVENT_EXPAND, arena, arena->region, arena->size, 0);
+            return arena;
+        }
+    }
+
+    if (arena->growth == 0)
+    {
+        return NULL;
+    }
+
+    return arena_add_block(arena, size);
+}
+
+
+void* arena_alloc_grow(Arena *arena, size_t size, unsigned int alignment)
+{
+    /* Room is made for the worst case padding, so that the retry cannot fail */
+    if (size > (size_t)-1 - alignment || arena_reserve(arena, size + alignment) == NULL)
+    {
+        #ifdef ARENA_STATS
+        if (arena != NULL)
+        {
+            arena->stats.failures++;
+        }
+        #endif /* ARENA_STATS */
+
+        return NULL;
+    }
+
+    return arena_alloc_aligned(arena, size, alignment);
+}
+
+
+void* arena_realloc(Arena *arena, void *ptr, size_t old_size, size_t new_size)
+{
+    return arena_realloc_aligned(arena, ptr, old_size, new_size, ARENA_DEFAULT_ALIGNMENT);
+}
+
+
+void* arena_realloc_aligned(Arena *arena, void *ptr, size_t old_size, size_t new_size, unsigned int alignment)
+{
+    char *new_ptr;
+    size_t index;
+
+    if (arena == NULL || new_size == 0)
+    {
+        return NULL;
+    }
+
+    if (ptr == NULL)
+    {
+        new_ptr = arena_alloc_aligned(arena, new_size, alignment);
+        if (new_ptr != NULL)
+        {
+            ARENA_TRACE_NESTED(ARENA_EVENT_ALLOC, arena, new_ptr, new_size, alignment);
+        }
+        return new_ptr;
+    }
+
+    /* Only the tail of the current block can move without copying */
+    if ((char *)ptr >= arena->region && (char *)ptr <= arena->region + arena->index)
+    {
+        index = (size_t)((char *)ptr - arena->region);
+
+        /* Virtual arenas can commit more of their reservation behind the tail, rather than copy it */
+        if (arena->index - index == old_size && new_size > old_size
+            && arena->size - arena->index < new_size - old_size
+            && (arena->flags & ARENA_FLAG_VIRTUAL) && arena->blocks == NULL
+            && new_size - old_size <= (size_t)-1 - arena->index
+            && arena_commit(arena, arena->index + (new_size - old_size)) != NULL)
+        {
+            ARENA_TRACE_UNWRAPPED(ARENA_EVENT_EXPAND, arena, arena->region, arena->size, 0);
+        }
+
+        if (arena->index - index == old_size
+            && (new_size <= old_size || arena->size - arena->index >= new_size - old_size))
+        {
+            if (new_size < old_size && (arena->flags & ARENA_FLAG_ZERO))
+            {
+                ARENA_MEMSET((char *)ptr + new_size, 0, old_size - new_size);
+            }
+
+            arena->index = index + new_size;
+            if (arena->dirty > arena->index)
+            {
+                arena->dirty = arena->index;
+            }
+
+            if (new_size > old_size)
+            {
+                #ifdef ARENA_STATS
+                ARENA_STATS_RECORD(arena, new_size - old_size, 0);
+                #endif /* ARENA_STATS */
+
+                ARENA_TRACE_UNWRAPPED(ARENA_EVENT_ALLOC, arena, (char *)ptr + old_size, new_size - old_size, 1);
+            }
+
+            #ifdef ARENA_DEBUG
+            if (arena->allocations > 0 && ARENA_ALLOCATION_AT(arena, arena->allocations - 1)->index == index)
+            {
+                ARENA_ALLOCATION_AT(arena, arena->allocations - 1)->size = new_size;
+            }
+            #endif /* ARENA_DEBUG */
+
+            return ptr;
+        }
+    }
+
+    if (new_size <= old_size)
+    {
+        return ptr;
+    }
+
+    new_ptr = arena_alloc_aligned(arena, new_size, alignment);
+    if (new_ptr == NULL)
+    {
+        return NULL;
+    }
+
+    ARENA_TRACE_NESTED(ARENA_EVENT_ALLOC, arena, new_ptr, new_size, alignment);
+    ARENA_MEMCPY(new_ptr, ptr, old_size);
+    return new_ptr;
+}
+
+
+void* arena_alloc_batch(Arena *arena, Arena_Request *requests, size_t count)
+{
+    size_t worst;
+    size_t position;
+    size_t i;
+
+    if (arena == NULL || arena->region == NULL || requests == NULL || count == 0)
+    {
+        return NULL;
+    }
+
+    worst = 0;
+    for (i = 0; i < count; i++)
+    {
+        if (requests[i].size == 0 || requests[i].size > (size_t)-1 - requests[i].alignment - worst)
+        {
+            return NULL;
+        }
+
+        worst += requests[i].size + requests[i].alignment;
+    }
+
+    #ifdef ARENA_GUARD
+    /* Each request needs its own canary, so they are allocated one at a time */
+    if (arena->flags & ARENA_FLAG_GUARD)
+    {
+        Arena_Marker marker = arena_mark(arena);
+
+        for (i = 0; i < count; i++)
+        {
+            requests[i].pointer = arena_alloc_aligned(arena, requests[i].size, requests[i].alignment);
+            if (requests[i].pointer == NULL)
+            {
+                arena_rewind(arena, marker);
+                return NULL;
+            }
+
+            ARENA_TRACE_NESTED(ARENA_EVENT_ALLOC, arena, requests[i].pointer, requests[i].size,
+                               requests[i].alignment);
+        }
+
+        return requests[0].pointer;
+    }
+    #endif /* ARENA_GUARD */
+
+    /* Unless even the worst case padding fits, the exact layout decides whether to grow */
+    if (arena->size - arena->index < worst)
+    {
+        position = arena->index;
+        for (i = 0; i < count; i++)
+        {
+            size_t offset = ARENA_ALIGN_PADDING(arena->region + position, requests[i].alignment);
+
+            if (arena->size - position < offset || arena->size - position - offset < requests[i].size)
+            {
+                break;
+            }
+
+            position += offset + requests[i].size;
+        }
+
+        if (i < count && arena_reserve(arena, worst) == NULL)
+        {
+            #ifdef ARENA_STATS
+            arena->stats.failures++;
+            #endif /* ARENA_STATS */
+
+            return NULL;
+        }
+    }
+
+    position = arena->index;
+    for (i = 0; i < count; i++)
+    {
+        size_t offset = ARENA_ALIGN_PADDING(arena->region + position, requests[i].alignment);
+
+        position += offset;
+        requests[i].pointer = arena->region + position;
+
+        #ifdef ARENA_STATS
+        arena->stats.requested += requests[i].size;
+        arena->stats.padding += offset;
+        #endif /* ARENA_STATS */
+
+        #ifdef ARENA_DEBUG
+        arena->index = position;
+        arena_add_allocation(arena, requests[i].size);
+        #endif /* ARENA_DEBUG */
+
+        ARENA_TRACE_UNWRAPPED(ARENA_EVENT_ALLOC, arena, requests[i].pointer, requests[i].size,
+                              requests[i].alignment);
+        position += requests[i].size;
+    }
+
+    arena->index = position;
+
+    #ifdef ARENA_STATS
+    ARENA_STATS_PEAK(arena);
+    #endif /* ARENA_STATS */
+
+    return requests[0].pointer;
+}
+
+
+void* arena_calloc(Arena *arena, size_t count, size_t size)
+{
+    return arena_calloc_aligned(arena, count, size, ARENA_DEFAULT_ALIGNMENT);
+}
+
+
+void* arena_calloc_aligned(Arena *arena, size_t count, size_t size, unsigned int alignment)
+{
+    void *ptr;
+
+    if (size != 0 && count > (size_t)-1 / size)
+    {
+        return NULL;
+    }
+
+    ptr = arena_alloc_aligned(arena, count * size, alignment);
+    if (ptr != NULL && !(arena->flags & ARENA_FLAG_ZERO))
+    {
+        ARENA_MEMSET(ptr, 0, count * size);
+    }
+
+    return ptr;
+}
+
+
+size_t arena_copy(Arena *dest, Arena *src)
+{
+    size_t bytes;
+
+    if (dest == NULL || src == NULL)
+    {
+        return 0;
+    }
+
+    if (src->index < dest->size)
+    {
+        bytes = src->index;
+    }
+    else
+    {
+        bytes = dest->size;
+    }
+
+    ARENA_MEMCPY(dest->region, src->region, bytes);
+    if ((dest->flags & ARENA_FLAG_ZERO) && dest->index > bytes)
+    {
+        ARENA_MEMSET(dest->region + bytes, 0, dest->index - bytes);
+    }
+    dest->index = bytes;
+    dest->dirty = 0;
+    dest->generation++;
+    src->dirty = bytes;
+
+    return bytes;
+}
+
+
+size_t arena_copy_delta(Arena *dest, Arena *src)
+{
+    size_t start;
+    size_t end;
+
+    if (dest == NULL || src == NULL)
+    {
+        return 0;
+    }
+
+    end = src->index < dest->size ? src->index : dest->size;
+    start = src->dirty < end ? src->dirty : end;
+
+    ARENA_MEMCPY(dest->region + start, src->region + start, end - start);
+    if ((dest->flags & ARENA_FLAG_ZERO) && dest->index > end)
+    {
+        ARENA_MEMSET(dest->region + end, 0, dest->index - end);
+    }
+    dest->index = end;
+    if (dest->dirty > start)
+    {
+        dest->dirty = start;
+    }
+    dest->generation++;
+    src->dirty = end;
+
+    return end - start;
+}
+
+
+void arena_touch(Arena *arena, void *pointer)
+{
+    size_t index;
+
+    if (arena == NULL || (char *)pointer < arena->region || (char *)pointer >= arena->region + arena->index)
+    {
+        return;
+    }
+
+    index = (size_t)((char *)pointer - arena->region);
+    if (arena->dirty > index)
+    {
+        arena->dirty = index;
+    }
+}
+
+
+Arena* arena_fork(Arena *arena)
+{
+    Arena *fork;
+    char *region;
+
+    if (arena == NULL)
+    {
+        return NULL;
+    }
+
+    #ifdef ARENA_VIRTUAL_POSIX
+    /* A read-only mapping holds exactly what is in the file, so a private mapping of it is a fork */
+    if (ARENA_READ_ONLY(arena) && arena->reserved != 0)
+    {
+        char *base;
+        int fd;
+
+        fd = dup(ARENA_MAPPED_FILE(arena));
+        if (fd < 0)
+        {
+            return NULL;
+        }
+
+        base = mmap(NULL, arena->reserved, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+        if (base == MAP_FAILED)
+        {
+            close(fd);
+            return NULL;
+        }
+
+        fork = ARENA_MALLOC(sizeof(Arena) + sizeof(int));
+        if (fork == NULL)
+        {
+            munmap(base, arena->reserved);
+            close(fd);
+            return NULL;
+        }
+
+        arena_init_fields(fork, base + (arena->region - ARENA_MAPPED_BASE(arena)), arena->size,
+                          ARENA_FLAG_FREE_ARENA | ARENA_FLAG_MAPPED | ARENA_FLAG_COPY_ON_WRITE, arena->reserved);
+        fork->index = arena->index;
+        ARENA_MAPPED_FILE(fork) = fd;
+
+        return fork;
+    }
+    #endif /* ARENA_VIRTUAL_POSIX */
+
+    if (arena->size > (size_t)-1 - sizeof(Arena) - ARENA_IMAGE_ALIGNMENT)
+    {
+        return NULL;
+    }
+
+    /* Like arena_create_inline, with the region placed where the source's is within a page */
+    fork = ARENA_MALLOC(sizeof(Arena) + ARENA_IMAGE_ALIGNMENT + arena->size);
+    if (fork == NULL)
+    {
+        return NULL;
+    }
+
+    region = (char *)(fork + 1);
+    region += ((size_t)arena->region - (size_t)region) % ARENA_IMAGE_ALIGNMENT;
+    arena_init_fields(fork, region, arena->size, ARENA_FLAG_FREE_ARENA, 0);
+
+    /* Not arena_copy, which would count as a sync of the source for arena_copy_delta */
+    ARENA_MEMCPY(fork->region, arena->region, arena->index);
+    fork->index = arena->index;
+
+    if (arena->flags & ARENA_FLAG_ZERO)
+    {
+        arena_keep_zeroed(fork);
+    }
+
+    return fork;
+}
+
+
+Arena* arena_split(Arena *parent, size_t size)
+{
+    void *buffer;
+
+    if (parent == NULL || size == 0 || size > (size_t)-1 - sizeof(Arena))
+    {
+        return NULL;
+    }
+
+    buffer = arena_alloc_aligned(parent, sizeof(Arena) + size, ARENA_ALIGNOF(Arena));
+    if (buffer == NULL)
+    {
+        return NULL;
+    }
+
+    return arena_create_from_buffer(buffer, sizeof(Arena) + size);
+}
+
+
+Arena* arena_merge(Arena *parent, Arena *child)
+{
+    size_t header;
+
+    if (parent == NULL || child == NULL)
+    {
+        return NULL;
+    }
+
+    /* Only a child whose region follows its header in one allocation can be shrunk */
+    if (child->blocks != NULL || (child->flags & (ARENA_FLAG_FREE_REGION | ARENA_FLAG_FREE_ARENA
+                                                  | ARENA_FLAG_VIRTUAL | ARENA_FLAG_MAPPED))
+        || child->region < (char *)(child + 1))
+    {
+        return NULL;
+    }
+
+    /* Shrinking the child's allocation in place is exactly what arena_realloc does */
+    header = (size_t)(child->region - (char *)child);
+    arena_realloc(parent, child, header + child->size, header + child->index);
+
+    #ifdef ARENA_DEBUG
+    arena_delete_allocation_list(child);
+    #endif /* ARENA_DEBUG */
+
+    return parent;
+}
+
+
+Arena* arena_save(Arena *arena, const char *path)
+{
+    static const char padding[64] = {0};
+    Arena_Image image;
+    size_t written;
+    size_t chunk;
+    FILE *file;
+
+    if (arena == NULL || path == NULL)
+    {
+        return NULL;
+    }
+
+    ARENA_MEMCPY(image.magic, ARENA_IMAGE_MAGIC, sizeof(image.magic));
+    image.index = arena->index;
+    image.offset = ARENA_IMAGE_ALIGNMENT + (size_t)arena->region % ARENA_IMAGE_ALIGNMENT;
+
+    file = fopen(path, "wb");
+    if (file == NULL)
+    {
+        return NULL;
+    }
+
+    written = fwrite(&image, sizeof(image), 1, file) == 1 ? sizeof(image) : 0;
+    while (written != 0 && written < image.offset)
+    {
+        chunk = image.offset - written < sizeof(padding) ? image.offset - written : sizeof(padding);
+        written = fwrite(padding, 1, chunk, file) == chunk ? written + chunk : 0;
+    }
+
+    if (written == 0 || fwrite(arena->region, 1, arena->index, file) != arena->index)
+    {
+        fclose(file);
+        remove(path);
+        return NULL;
+    }
+
+    if (fclose(file) != 0)
+    {
+        remove(path);
+        return NULL;
+    }
+
+    return arena;
+}
+
+
+Arena* arena_map(const char *path, unsigned int flags)
+{
+    Arena_Image image;
+    Arena *arena;
+    char *region;
+    size_t length;
+
+    if (path == NULL)
+    {
+        return NULL;
+    }
+
+    #if defined(ARENA_VIRTUAL_POSIX)
+    {
+        struct stat status;
+        char *base;
+        int fd;
+
+        fd = open(path, O_RDONLY);
+        if (fd < 0)
+        {
+            return NULL;
+        }
+
+        if (fstat(fd, &status) != 0 || (size_t)status.st_size < sizeof(image))
+        {
+            close(fd);
+            return NULL;
+        }
+
+        length = (size_t)status.st_size;
+        if (flags & ARENA_FLAG_COPY_ON_WRITE)
+        {
+            base = mmap(NULL, length, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+        }
+        else
+        {
+            base = mmap(NULL, length, PROT_READ, MAP_SHARED, fd, 0);
+        }
+
+        if (base == MAP_FAILED)
+        {
+            close(fd);
+            return NULL;
+        }
+
+        ARENA_MEMCPY(&image, base, sizeof(image));
+        if (ARENA_MEMCMP(image.magic, ARENA_IMAGE_MAGIC, sizeof(image.magic)) != 0
+            || image.offset < ARENA_IMAGE_ALIGNMENT || image.offset >= 2 * ARENA_IMAGE_ALIGNMENT
+            || image.offset > length || length - image.offset != image.index)
+        {
+            munmap(base, length);
+            close(fd);
+            return NULL;
+        }
+
+        arena = ARENA_MALLOC(sizeof(Arena) + sizeof(int));
+        if (arena == NULL)
+        {
+            munmap(base, length);
+            close(fd);
+            return NULL;
+        }
+
+        region = base + image.offset;
+        ARENA_MAPPED_FILE(arena) = fd;
+    }
+    #else
+    {
+        FILE *file;
+        size_t padding;
+
+        file = fopen(path, "rb");
+        if (file == NULL)
+        {
+            return NULL;
+        }
+
+        if (fread(&image, sizeof(image), 1, file) != 1
+            || ARENA_MEMCMP(image.magic, ARENA_IMAGE_MAGIC, sizeof(image.magic)) != 0
+            || image.offset < ARENA_IMAGE_ALIGNMENT || image.offset >= 2 * ARENA_IMAGE_ALIGNMENT
+            || image.index > (size_t)-1 - sizeof(Arena) - ARENA_IMAGE_ALIGNMENT
+            || fseek(file, (long)image.offset, SEEK_SET) != 0)
+        {
+            fclose(file);
+            return NULL;
+        }
+
+        /* Like arena_create_inline, with the region placed where it was within a page */
+        arena = ARENA_MALLOC(sizeof(Arena) + ARENA_IMAGE_ALIGNMENT + image.index);
+        if (arena == NULL)
+        {
+            fclose(file);
+            return NULL;
+        }
+
+        region = (char *)(arena + 1);
+        padding = (image.offset - (size_t)region % ARENA_IMAGE_ALIGNMENT) % ARENA_IMAGE_ALIGNMENT;
+        region += padding;
+
+        if (fread(region, 1, image.index, file) != image.index || fgetc(file) != EOF)
+        {
+            ARENA_FREE(arena);
+            fclose(file);
+            return NULL;
+        }
+
+        fclose(file);
+        length = 0;
+    }
+    #endif
+
+    arena_init_fields(arena, region, image.index,
+                      ARENA_FLAG_FREE_ARENA | ARENA_FLAG_MAPPED | (flags & ARENA_FLAG_COPY_ON_WRITE), length);
+    arena->index = image.index;
+
+    return arena;
+}
+
+
+Arena_Marker arena_mark(Arena *arena)
+{
+    Arena_Marker marker;
+
+    marker.block = NULL;
+    marker.index = 0;
+
+    #ifdef ARENA_DEBUG
+    marker.allocations = 0;
+    #endif /* ARENA_DEBUG */
+
+    if (arena == NULL)
+    {
+        return marker;
+    }
+
+    marker.block = arena->blocks;
+    marker.index = arena->index;
+
+    #ifdef ARENA_DEBUG
+    marker.allocations = arena->allocations;
+    #endif /* ARENA_DEBUG */
+
+    return marker;
+}
+
+
+void arena_rewind(Arena *arena, Arena_Marker marker)
+{
+    if (arena == NULL)
+    {
+        return;
+    }
+
+    if (ARENA_READ_ONLY(arena))
+    {
+        #ifdef ARENA_GUARD
+        ARENA_GUARD_FAIL(arena, arena->region);
+        #endif /* ARENA_GUARD */
+        return;
+    }
+
+    while (arena->blocks != marker.block && arena->blocks != NULL)
+    {
+        arena_pop_block(arena);
+    }
+
+    /* The marker's block is gone, so there is nothing valid to rewind to */
+    if (arena->blocks != marker.block || marker.index > arena->index)
+    {
+        return;
+    }
+
+    if (arena->flags & ARENA_FLAG_ZERO)
+    {
+        ARENA_MEMSET(arena->region + marker.index, 0, arena->index - marker.index);
+    }
+
+    #ifdef ARENA_GUARD
+    arena_guard_poison(arena, marker.index);
+    #endif /* ARENA_GUARD */
+
+    /* Pools and size classes may have memory past the marker in their free lists */
+    if (marker.index < arena->index)
+    {
+        arena->generation++;
+    }
+
+    arena->index = marker.index;
+    if (arena->dirty > arena->index)
+    {
+        arena->dirty = arena->index;
+    }
+
+    #ifdef ARENA_DEBUG
+    arena_trim_allocation_list(arena, marker.allocations);
+    #endif /* ARENA_DEBUG */
+}
+
+
+void arena_keep_zeroed(Arena *arena)
+{
+    Arena_Block *block;
+
+    if (arena == NULL || (arena->flags & ARENA_FLAG_ZERO))
+    {
+        return;
+    }
+
+    #ifdef ARENA_GUARD
+    if (arena->flags & ARENA_FLAG_GUARD)
+    {
+        ARENA_ASAN_UNPOISON(arena->region + arena->index, arena->size - arena->index);
+    }
+    #endif /* ARENA_GUARD */
+
+    ARENA_MEMSET(arena->region + arena->index, 0, arena->size - arena->index);
+
+    /* Earlier blocks become current again when later ones are popped */
+    for (block = arena->blocks; block != NULL; block = block->prev)
+    {
+        #ifdef ARENA_GUARD
+        if (arena->flags & ARENA_FLAG_GUARD)
+        {
+            ARENA_ASAN_UNPOISON(block->region + block->index, block->size - block->index);
+        }
+        #endif /* ARENA_GUARD */
+
+        ARENA_MEMSET(block->region + block->index, 0, block->size - block->index);
+
+        #ifdef ARENA_GUARD
+        if (arena->flags & ARENA_FLAG_GUARD)
+        {
+            ARENA_ASAN_POISON(block->region + block->index, block->size - block->index);
+        }
+        #endif /* ARENA_GUARD */
+    }
+
+    #ifdef ARENA_GUARD
+    if (arena->flags & ARENA_FLAG_GUARD)
+    {
+        ARENA_ASAN_POISON(arena->region + arena->index, arena->size - arena->index);
+    }
+    #endif /* ARENA_GUARD */
+
+    arena->flags |= ARENA_FLAG_ZERO;
+}
+
+
+void arena_zero_used(Arena *arena)
+{
+    size_t used;
+
+    if (arena == NULL)
+    {
+        return;
+    }
+
+    used = arena->index;
+    if ((arena->flags & ARENA_FLAG_DECOMMIT) && arena->blocks == NULL
+        && used > ARENA_COMMIT_STEP(arena) - sizeof(Arena))
+    {
+        used = ARENA_COMMIT_STEP(arena) - sizeof(Arena);
+    }
+
+    ARENA_MEMSET(arena->region, 0, used);
+    arena->dirty = 0;
+}
+
+
+void arena_destroy(Arena *arena)
+{
+    #ifdef ARENA_GUARD
+    void *damaged;
+    #endif /* ARENA_GUARD */
+
+    if (arena == NULL)
+    {
+        return;
+    }
+
+    ARENA_TRACE_EVENT(ARENA_EVENT_DESTROY, arena, arena->region, arena->size, 0);
+
+    #ifdef ARENA_DEBUG
+    arena_delete_allocation_list(arena);
+    #endif /* ARENA_DEBUG */
+
+    #ifdef ARENA_GUARD
+    if ((arena->flags & ARENA_FLAG_GUARD) && (damaged = arena_guard_check(arena)) != NULL)
+    {
+        ARENA_GUARD_FAIL(arena, damaged);
+    }
+    #endif /* ARENA_GUARD */
+
+    while (arena->blocks != NULL)
+    {
+        arena_pop_block(arena);
+    }
+
+    #ifdef ARENA_GUARD
+    /* Buffers and mappings outlive the arena, so nothing may be left poisoned in them */
+    if (arena->flags & ARENA_FLAG_GUARD)
+    {
+        if (arena->flags & ARENA_FLAG_VIRTUAL)
+        {
+            ARENA_ASAN_UNPOISON(arena->region, arena->reserved - sizeof(Arena));
+        }
+        else
+        {
+            ARENA_ASAN_UNPOISON(arena->region, arena->size);
+        }
+    }
+    #endif /* ARENA_GUARD */
+
+    if (arena->region != NULL && (arena->flags & ARENA_FLAG_FREE_REGION))
+    {
+        ARENA_FREE(arena->region);
+    }
+
+    #ifdef ARENA_VIRTUAL_POSIX
+    if ((arena->flags & ARENA_FLAG_MAPPED) && arena->reserved != 0)
+    {
+        munmap(ARENA_MAPPED_BASE(arena), arena->reserved);
+        close(ARENA_MAPPED_FILE(arena));
+    }
+    #endif /* ARENA_VIRTUAL_POSIX */
+
+    if (arena->flags & ARENA_FLAG_FREE_ARENA)
+    {
+        ARENA_FREE(arena);
+    }
+    else if (arena->flags & ARENA_FLAG_VIRTUAL)
+    {
+        #if defined(ARENA_VIRTUAL_POSIX)
+        munmap(arena, arena->reserved);
+        #elif defined(ARENA_VIRTUAL_WINDOWS)
+        VirtualFree(arena, 0, MEM_RELEASE);
+        #endif
+    }
+}
+
+
+void arena_pool_init(Arena_Pool *pool, Arena *arena, size_t slot_size, unsigned int alignment)
+{
+    if (pool == NULL)
+    {
+        return;
+    }
+
+    pool->arena = slot_size != 0 ? arena : NULL;
+
+    if (slot_size < sizeof(void *))
+    {
+        slot_size = sizeof(void *);
+    }
+
+    if (alignment < ARENA_ALIGNOF(void *))
+    {
+        alignment = ARENA_ALIGNOF(void *);
+    }
+
+    pool->free_list = NULL;
+    pool->slot_size = slot_size;
+    pool->alignment = alignment;
+    pool->generation = pool->arena != NULL ? arena->generation : 0;
+}
+
+
+void* arena_pool_alloc(Arena_Pool *pool)
+{
+    void *slot;
+
+    if (pool == NULL || pool->arena == NULL)
+    {
+        return NULL;
+    }
+
+    /* Free slots from before the arena was cleared now belong to someone else */
+    if (pool->generation != pool->arena->generation)
+    {
+        pool->free_list = NULL;
+        pool->generation = pool->arena->generation;
+    }
+
+    if (pool->free_list != NULL)
+    {
+        slot = pool->free_list;
+        pool->free_list = *(void **)slot;
+        return slot;
+    }
+
+    return arena_alloc_aligned(pool->arena, pool->slot_size, pool->alignment);
+}
+
+
+void arena_pool_free(Arena_Pool *pool, void *ptr)
+{
+    if (pool == NULL || pool->arena == NULL || ptr == NULL)
+    {
+        return;
+    }
+
+    if (pool->generation != pool->arena->generation)
+    {
+        return;
+    }
+
+    *(void **)ptr = pool->free_list;
+    pool->free_list = ptr;
+}
+
+
+void arena_classes_init(Arena_Classes *classes, Arena *arena, size_t chunk_size)
+{
+    int i;
+
+    if (classes == NULL)
+    {
+        return;
+    }
+
+    classes->arena = chunk_size != 0 ? arena : NULL;
+    for (i = 0; i < ARENA_CLASS_COUNT; i++)
+    {
+        classes->regions[i] = NULL;
+        classes->indices[i] = 0;
+        classes->sizes[i] = 0;
+    }
+    classes->chunk_size = chunk_size;
+    classes->generation = classes->arena != NULL ? arena->generation : 0;
+}
+
+
+void* arena_classes_alloc(Arena_Classes *classes, size_t size, unsigned int alignment)
+{
+    static const unsigned int alignments[ARENA_CLASS_COUNT] = {1, 8, 16, 64};
+    size_t offset;
+    char *region;
+    int i;
+
+    if (size == 0 || classes == NULL || classes->arena == NULL)
+    {
+        return NULL;
+    }
+
+    /* The chunks are memory the arena has handed out again since it was cleared */
+    if (classes->generation != classes->arena->generation)
+    {
+        arena_classes_init(classes, classes->arena, classes->chunk_size);
+    }
+
+    i = 0;
+    while (i < ARENA_CLASS_COUNT && alignments[i] < alignment)
+    {
+        i++;
+    }
+
+    if (i == ARENA_CLASS_COUNT || (alignment & (alignment - 1)) != 0 || size > classes->chunk_size / 2)
+    {
+        return arena_alloc_aligned(classes->arena, size, alignment);
+    }
+
+    region = classes->regions[i];
+    if (region != NULL)
+    {
+        offset = ARENA_ALIGN_PADDING(region + classes->indices[i], alignment);
+        if (classes->sizes[i] - classes->indices[i] >= offset
+            && classes->sizes[i] - classes->indices[i] - offset >= size)
+        {
+            classes->indices[i] += offset + size;
+            return region + (classes->indices[i] - size);
+        }
+    }
+
+    /* Chunks start at the i's alignment, so the first allocation in one never pads */
+    region = arena_alloc_aligned(classes->arena, classes->chunk_size, alignments[i]);
+    if (region == NULL)
+    {
+        return arena_alloc_aligned(classes->arena, size, alignment);
+    }
+
+    classes->regions[i] = region;
+    classes->indices[i] = size;
+    classes->sizes[i] = classes->chunk_size;
+
+    return region;
+}
+
+
+void arena_cache_init(Arena_Cache *cache, size_t capacity)
+{
+    size_t i;
+
+    if (cache == NULL)
+    {
+        return;
+    }
+
+    for (i = 0; i < ARENA_CACHE_BUCKETS; i++)
+    {
+        cache->buckets[i] = NULL;
+    }
+    cache->retained = 0;
+    cache->capacity = capacity;
+}
+
+
+Arena* arena_cache_acquire(Arena_Cache *cache, size_t size)
+{
+    Arena *previous;
+    Arena *arena;
+    size_t bucket;
+
+    if (size == 0)
+    {
+        return NULL;
+    }
+
+    if (cache == NULL)
+    {
+        return arena_create(size);
+    }
+
+    bucket = 0;
+    while ((size >> bucket) > 1)
+    {
+        bucket++;
+    }
+
+    /* Arenas in the size's own bucket might be too small, those in the next one never are */
+    previous = NULL;
+    arena = cache->buckets[bucket];
+    while (arena != NULL && arena->size < size)
+    {
+        previous = arena;
+        ARENA_MEMCPY(&arena, previous->region, sizeof(Arena *));
+    }
+
+    if (arena == NULL && bucket + 1 < ARENA_CACHE_BUCKETS)
+    {
+        bucket++;
+        previous = NULL;
+        arena = cache->buckets[bucket];
+    }
+
+    if (arena == NULL)
+    {
+        return arena_create(size);
+    }
+
+    /* Links are copied rather than dereferenced, regions need not be aligned for pointers */
+    if (previous == NULL)
+    {
+        ARENA_MEMCPY(&cache->buckets[bucket], arena->region, sizeof(Arena *));
+    }
+    else
+    {
+        ARENA_MEMCPY(previous->region, arena->region, sizeof(Arena *));
+    }
+    cache->retained -= arena->size;
+
+    if (arena->flags & ARENA_FLAG_ZERO)
+    {
+        ARENA_MEMSET(arena->region, 0, sizeof(Arena *));
+    }
+
+    #ifdef ARENA_GUARD
+    if (arena->flags & ARENA_FLAG_GUARD)
+    {
+        ARENA_ASAN_POISON(arena->region, sizeof(Arena *));
+    }
+    #endif /* ARENA_GUARD */
+
+    return arena;
+}
+
+
+void arena_cache_release(Arena_Cache *cache, Arena *arena)
+{
+    size_t bucket;
+
+    if (arena == NULL)
+    {
+        return;
+    }
+
+    if (cache == NULL || arena->size < sizeof(Arena *) || arena->size > cache->capacity - cache->retained
+        || (arena->flags & ARENA_FLAG_MAPPED) || !(arena->flags & (ARENA_FLAG_FREE_ARENA | ARENA_FLAG_VIRTUAL)))
+    {
+        arena_destroy(arena);
+        return;
+    }
+
+    arena_clear(arena);
+
+    /* Decommitting may have shrunk the region */
+    bucket = 0;
+    while ((arena->size >> bucket) > 1)
+    {
+        bucket++;
+    }
+
+    #ifdef ARENA_GUARD
+    ARENA_ASAN_UNPOISON(arena->region, sizeof(Arena *));
+    #endif /* ARENA_GUARD */
+
+    ARENA_MEMCPY(arena->region, &cache->buckets[bucket], sizeof(Arena *));
+    cache->buckets[bucket] = arena;
+    cache->retained += arena->size;
+}
+
+
+void arena_cache_flush(Arena_Cache *cache)
+{
+    Arena *arena;
+    size_t i;
+
+    if (cache == NULL)
+    {
+        return;
+    }
+
+    for (i = 0; i < ARENA_CACHE_BUCKETS; i++)
+    {
+        while (cache->buckets[i] != NULL)
+        {
+            arena = cache->buckets[i];
+            ARENA_MEMCPY(&cache->buckets[i], arena->region, sizeof(Arena *));
+            arena_destroy(arena);
+        }
+    }
+    cache->retained = 0;
+}
+
+
+Arena_Ring* arena_ring_create(unsigned int count, size_t size)
+{
+    Arena_Ring *ring;
+
+    if (count < 2 || count > ARENA_RING_MAX || size == 0)
+    {
+        return NULL;
+    }
+
+    ring = ARENA_MALLOC(sizeof(Arena_Ring));
+    if (ring == NULL)
+    {
+        return NULL;
+    }
+
+    ring->current = 0;
+    ring->epoch = 0;
+    for (ring->count = 0; ring->count < count; ring->count++)
+    {
+        ring->arenas[ring->count] = arena_create(size);
+        if (ring->arenas[ring->count] == NULL)
+        {
+            arena_ring_destroy(ring);
+            return NULL;
+        }
+    }
+
+    return ring;
+}
+
+
+Arena* arena_ring_arena(Arena_Ring *ring, unsigned int age)
+{
+    if (ring == NULL || age >= ring->count)
+    {
+        return NULL;
+    }
+
+    return ring->arenas[(ring->current + ring->count - age) % ring->count];
+}
+
+
+void* arena_ring_alloc(Arena_Ring *ring, size_t size)
+{
+    return arena_alloc(arena_ring_arena(ring, 0), size);
+}
+
+
+Arena* arena_ring_advance(Arena_Ring *ring)
+{
+    if (ring == NULL)
+    {
+        return NULL;
+    }
+
+    ring->current = (ring->current + 1) % ring->count;
+    ring->epoch++;
+    arena_clear(ring->arenas[ring->current]);
+
+    return ring->arenas[ring->current];
+}
+
+
+void arena_ring_destroy(Arena_Ring *ring)
+{
+    unsigned int i;
+
+    if (ring == NULL)
+    {
+        return;
+    }
+
+    for (i = 0; i < ring->count; i++)
+    {
+        arena_destroy(ring->arenas[i]);
+    }
+
+    ARENA_FREE(ring);
+}
+
+
+void arena_array_init(Arena_Array *array, Arena *arena, size_t element_size, unsigned int alignment)
+{
+    if (array == NULL)
+    {
+        return;
+    }
+
+    array->arena = element_size == 0 ? NULL : arena;
+    array->data = NULL;
+    array->count = 0;
+    array->capacity = 0;
+    array->element_size = element_size;
+    array->alignment = alignment;
+}
+
+
+void* arena_array_reserve(Arena_Array *array, size_t count)
+{
+    size_t capacity;
+    char *data;
+
+    if (array == NULL || array->arena == NULL || count == 0)
+    {
+        return NULL;
+    }
+
+    if (array->capacity - array->count < count)
+    {
+        if (count > ((size_t)-1) / array->element_size - array->count)
+        {
+            return NULL;
+        }
+
+        /* Doubling keeps the copies, when the array cannot grow in place, amortised O(1) per element */
+        capacity = array->count + count;
+        if (array->capacity <= ((size_t)-1) / array->element_size / 2 && capacity < array->capacity * 2)
+        {
+            capacity = array->capacity * 2;
+        }
+
+        data = arena_realloc_aligned(array->arena, array->data, array->capacity * array->element_size,
+                                     capacity * array->element_size, array->alignment);
+        if (data == NULL)
+        {
+            return NULL;
+        }
+
+        array->data = data;
+        array->capacity = capacity;
+    }
+
+    return array->data + array->count * array->element_size;
+}
+
+
+void* arena_array_append(Arena_Array *array, const void *elements, size_t count)
+{
+    char *end = arena_array_reserve(array, count);
+
+    if (end == NULL)
+    {
+        return NULL;
+    }
+
+    if (elements != NULL)
+    {
+        ARENA_MEMCPY(end, elements, count * array->element_size);
+    }
+
+    array->count += count;
+    return end;
+}
+
+
+Arena_Slice arena_array_freeze(Arena_Array *array)
+{
+    Arena_Slice slice;
+
+    slice.data = NULL;
+    slice.count = 0;
+
+    if (array == NULL)
+    {
+        return slice;
+    }
+
+    if (array->count != 0)
+    {
+        /* Shrinking never moves, it only gives the tail back if it can */
+        arena_realloc(array->arena, array->data, array->capacity * array->element_size,
+                      array->count * array->element_size);
+        slice.data = array->data;
+        slice.count = array->count;
+    }
+
+    array->data = NULL;
+    array->count = 0;
+    array->capacity = 0;
+
+    return slice;
+}
+
+
+void arena_string_init(Arena_String *string, Arena *arena)
+{
+    if (string == NULL)
+    {
+        return;
+    }
+
+    string->arena = arena;
+    string->data = NULL;
+    string->length = 0;
+    string->capacity = 0;
+}
+
+
+char* arena_string_reserve(Arena_String *string, size_t length)
+{
+    size_t capacity;
+    char *data;
+
+    if (string == NULL || string->arena == NULL || length > (size_t)-1 - 1 - string->length)
+    {
+        return NULL;
+    }
+
+    /* The capacity always has room for the terminator, once there is any */
+    if (string->capacity - string->length < length + 1)
+    {
+        capacity = string->length + length + 1;
+        if (string->capacity <= ((size_t)-1) / 2 && capacity < string->capacity * 2)
+        {
+            capacity = string->capacity * 2;
+        }
+
+        data = arena_realloc_aligned(string->arena, string->data, string->capacity, capacity, 1);
+        if (data == NULL)
+        {
+            return NULL;
+        }
+
+        string->data = data;
+        string->capacity = capacity;
+    }
+
+    return string->data + string->length;
+}
+
+
+char* arena_string_append(Arena_String *string, const char *text, size_t length)
+{
+    char *end;
+
+    if (text == NULL)
+    {
+        return NULL;
+    }
+
+    end = arena_string_reserve(string, length);
+    if (end == NULL)
+    {
+        return NULL;
+    }
+
+    ARENA_MEMCPY(end, text, length);
+    string->length += length;
+    string->data[string->length] = '\0';
+
+    return string->data;
+}
+
+
+#ifdef ARENA_HAS_FORMAT
+
+char* arena_string_appendf(Arena_String *string, const char *format, ...)
+{
+    va_list args;
+    size_t spare;
+    int length;
+
+    if (string == NULL || string->arena == NULL || format == NULL)
+    {
+        return NULL;
+    }
+
+    spare = string->capacity - string->length;
+
+    va_start(args, format);
+    length = vsnprintf(string->data == NULL ? NULL : string->data + string->length, spare, format, args);
+    va_end(args);
+
+    if (length < 0)
+    {
+        if (string->data != NULL)
+        {
+            string->data[string->length] = '\0';
+        }
+
+        return NULL;
+    }
+
+    /* Too long for the spare capacity, so it is formatted again once there is room */
+    if ((size_t)length >= spare)
+    {
+        if (arena_string_reserve(string, (size_t)length) == NULL)
+        {
+            if (string->data != NULL)
+            {
+                string->data[string->length] = '\0';
+            }
+
+            return NULL;
+        }
+
+        va_start(args, format);
+        vsnprintf(string->data + string->length, (size_t)length + 1, format, args);
+        va_end(args);
+    }
+
+    string->length += (size_t)length;
+    return string->data;
+}
+
+#endif /* ARENA_HAS_FORMAT */
+
+
+Arena_Slice arena_string_freeze(Arena_String *string)
+{
+    Arena_Slice slice;
+
+    slice.data = NULL;
+    slice.count = 0;
+
+    if (string == NULL)
+    {
+        return slice;
+    }
+
+    if (string->data != NULL)
+    {
+        arena_realloc(string->arena, string->data, string->capacity, string->length + 1);
+        slice.data = string->data;
+        slice.count = string->length;
+    }
+
+    string->data = NULL;
+    string->length = 0;
+    string->capacity = 0;
+
+    return slice;
+}
+
+
+#ifdef ARENA_HAS_ATOMICS
+
+Arena_Concurrent* arena_concurrent_create(size_t size)
+{
+    Arena_Concurrent *arena;
+    size_t header;
+
+    if (size == 0)
+    {
+        return NULL;
+    }
+
+    /* The region starts aligned so rounded sizes keep every allocation aligned */
+    header = sizeof(Arena_Concurrent) + ARENA_ALIGN_PADDING(sizeof(Arena_Concurrent), ARENA_DEFAULT_ALIGNMENT);
+    if (size > (size_t)-1 - header)
+    {
+        return NULL;
+    }
+
+    arena = ARENA_MALLOC(header + size);
+    if (arena == NULL)
+    {
+        return NULL;
+    }
+
+    arena->region = (char *)arena + header;
+    arena->size = size;
+    atomic_init(&arena->index, 0);
+    atomic_init(&arena->generation, 0);
+
+    return arena;
+}
+
+
+void* arena_concurrent_alloc(Arena_Concurrent *arena, size_t size)
+{
+    size_t index;
+
+    if (size == 0 || arena == NULL || size > arena->size)
+    {
+        return NULL;
+    }
+
+    size += ARENA_ALIGN_PADDING(size, ARENA_DEFAULT_ALIGNMENT);
+
+    /* The index only moves when the allocation fits, so a failed call cannot starve later ones */
+    index = atomic_load_explicit(&arena->index, memory_order_relaxed);
+    do
+    {
+        if (arena->size - index < size)
+        {
+            return NULL;
+        }
+    } while (!atomic_compare_exchange_weak_explicit(&arena->index, &index, index + size,
+                                                    memory_order_relaxed, memory_order_relaxed));
+
+    return arena->region + index;
+}
+
+
+void* arena_concurrent_alloc_aligned(Arena_Concurrent *arena, size_t size, unsigned int alignment)
+{
+    size_t index;
+    size_t offset;
+
+    if (size == 0 || arena == NULL)
+    {
+        return NULL;
+    }
+
+    index = atomic_load_explicit(&arena->index, memory_order_relaxed);
+    do
+    {
+        offset = ARENA_ALIGN_PADDING(arena->region + index, alignment);
+        if (index > arena->size || arena->size - index < offset || arena->size - index - offset < size)
+        {
+            return NULL;
+        }
+    } while (!atomic_compare_exchange_weak_explicit(&arena->index, &index, index + offset + size,
+                                                    memory_order_relaxed, memory_order_relaxed));
+
+    return arena->region + index + offset;
+}
+
+
+void arena_concurrent_clear(Arena_Concurrent *arena)
+{
+    if (arena == NULL)
+    {
+        return;
+    }
+
+    atomic_store_explicit(&arena->index, 0, memory_order_relaxed);
+    atomic_fetch_add_explicit(&arena->generation, 1, memory_order_relaxed);
+}
+
+
+void arena_concurrent_destroy(Arena_Concurrent *arena)
+{
+    if (arena == NULL)
+    {
+        return;
+    }
+
+    ARENA_FREE(arena);
+}
+
+
+void arena_local_init(Arena_Local *local, Arena_Concurrent *parent, size_t chunk_size)
+{
+    if (local == NULL)
+    {
+        return;
+    }
+
+    local->parent = chunk_size != 0 ? parent : NULL;
+    local->region = NULL;
+    local->index = 0;
+    local->size = 0;
+    local->chunk_size = chunk_size;
+    local->generation = 0;
+
+    if (local->parent != NULL)
+    {
+        local->generation = atomic_load_explicit(&parent->generation, memory_order_relaxed);
+    }
+}
 
-Parameters:
-  Arena *arena    |    The arena whose allocation list
-                       should be added to
-  size_t size     |    The size of the allocation being
-                       added.
-*/
-void arena_add_allocation(Arena *arena, size_t size);
 
+void* arena_local_alloc(Arena_Local *local, size_t size)
+{
+    return arena_local_alloc_aligned(local, size, ARENA_DEFAULT_ALIGNMENT);
+}
 
-/*
-Deletes the arena's linked list of allocations under
-debug.
 
-Parameters:
-  Arena *arena    |    The arena whose allocation list
-                       is being deleted.
-*/
-void arena_delete_allocation_list(Arena *arena);
+void* arena_local_alloc_aligned(Arena_Local *local, size_t size, unsigned int alignment)
+{
+    unsigned long generation;
+    size_t offset;
+    size_t chunk;
 
-#endif /* ARENA_DEBUG */
+    if (size == 0 || local == NULL || local->parent == NULL)
+    {
+        return NULL;
+    }
 
+    /* The chunk belongs to memory the parent has handed out again since it was cleared */
+    generation = atomic_load_explicit(&local->parent->generation, memory_order_relaxed);
+    if (generation != local->generation)
+    {
+        local->region = NULL;
+        local->index = 0;
+        local->size = 0;
+        local->generation = generation;
+    }
 
-#ifdef ARENA_IMPLEMENTATION
+    if (local->region != NULL)
+    {
+        offset = ARENA_ALIGN_PADDING(local->region + local->index, alignment);
+        if (local->size - local->index >= offset && local->size - local->index - offset >= size)
+        {
+            local->index += offset + size;
+            return local->region + (local->index - size);
+        }
+    }
 
+    /* Keep the current chunk for small allocations rather than wasting it on a big one */
+    if (size > local->chunk_size / 2)
+    {
+        return arena_concurrent_alloc_aligned(local->parent, size, alignment);
+    }
 
-#ifndef ARENA_MALLOC
-    #include <stdlib.h>
-    #define ARENA_MALLOC malloc
-#endif /* !ARENA_MALLOC */
+    /* The new chunk must fit the worst-case padding as well as the request */
+    chunk = local->chunk_size;
+    if (alignment > 1 && size + alignment - 1 > chunk)
+    {
+        chunk = size + alignment - 1;
+    }
 
-#ifndef ARENA_FREE
-    #include <stdlib.h>
-    #define ARENA_FREE free
-#endif /* !ARENA_FREE */
+    local->region = arena_concurrent_alloc(local->parent, chunk);
+    if (local->region == NULL)
+    {
+        local->index = 0;
+        local->size = 0;
+        return NULL;
+    }
 
-#ifndef ARENA_REALLOC
-    #include <stdlib.h>
-    #define ARENA_REALLOC realloc
-#endif
+    local->index = 0;
+    local->size = chunk;
 
-#ifndef ARENA_MEMCPY
-    #include <string.h>
-    #define ARENA_MEMCPY memcpy
-#endif /* !ARENA_MEMCPY */
+    offset = ARENA_ALIGN_PADDING(local->region, alignment);
+    if (local->size < offset || local->size - offset < size)
+    {
+        return NULL;
+    }
+
+    local->index = offset + size;
+    return local->region + offset;
+}
 
 
-Arena* arena_create(size_t size)
+Arena_Nodes* arena_nodes_create(size_t size)
 {
-    Arena *arena;
+    Arena_Nodes *nodes;
+    int node;
 
     if (size == 0)
     {
         return NULL;
     }
 
-    /* A malloc of 0 is implementation defined, so the above check is necessary */
-    arena = ARENA_MALLOC(sizeof(Arena));
-    if (arena == NULL)
+    nodes = ARENA_MALLOC(sizeof(Arena_Nodes));
+    if (nodes == NULL)
     {
         return NULL;
     }
 
-    arena->region = ARENA_MALLOC(size);
-    if (arena->region == NULL)
+    nodes->count = arena_node_count();
+    for (node = 0; node < nodes->count; node++)
+    {
+        nodes->arenas[node] = arena_concurrent_create(size);
+        if (nodes->arenas[node] == NULL)
+        {
+            nodes->count = node;
+            arena_nodes_destroy(nodes);
+            return NULL;
+        }
+
+        /* Without binding, first touch by the node's own threads places the region instead */
+        arena_bind_memory(nodes->arenas[node]->region, size, node);
+    }
+
+    return nodes;
+}
+
+
+Arena_Concurrent* arena_nodes_local(Arena_Nodes *nodes)
+{
+    if (nodes == NULL)
     {
-        ARENA_FREE(arena);
         return NULL;
     }
 
-    arena->index = 0;
-    arena->size = size;
+    return nodes->arenas[arena_current_node() % nodes->count];
+}
 
-    #ifdef ARENA_DEBUG
-    arena->head_allocation = NULL;
-    arena->allocations = 0;
-    #endif /* ARENA_DEBUG */
 
-    return arena;
+void* arena_nodes_alloc(Arena_Nodes *nodes, size_t size)
+{
+    return arena_concurrent_alloc(arena_nodes_local(nodes), size);
 }
 
 
-Arena* arena_expand(Arena *arena, size_t size)
+void arena_nodes_destroy(Arena_Nodes *nodes)
 {
-    if (arena == NULL || size <= arena->size)
+    int node;
+
+    if (nodes == NULL)
     {
-        return NULL;
+        return;
     }
 
-    arena->region = ARENA_REALLOC(arena->region, size);
-    if (arena->region == NULL)
+    for (node = 0; node < nodes->count; node++)
     {
-        return NULL;
+        arena_concurrent_destroy(nodes->arenas[node]);
     }
 
-    arena->size = size;
-    return arena;
+    ARENA_FREE(nodes);
 }
 
+#endif /* ARENA_HAS_ATOMICS */
 
-void* arena_alloc(Arena *arena, size_t size)
+
+#ifdef ARENA_TRACE_LOCATION
+
+void* arena_alloc_at(Arena *arena, size_t size, const char *file, int line)
 {
-    return arena_alloc_aligned(arena, size, ARENA_DEFAULT_ALIGNMENT);
+    void *ptr = arena_alloc(arena, size);
+    if (ptr != NULL)
+    {
+        ARENA_TRACE(ARENA_EVENT_ALLOC, arena, ptr, size, ARENA_DEFAULT_ALIGNMENT, file, line);
+    }
+    return ptr;
 }
 
 
-void* arena_alloc_aligned(Arena *arena, size_t size, unsigned int alignment)
+void* arena_alloc_aligned_at(Arena *arena, size_t size, unsigned int alignment, const char *file, int line)
 {
-    unsigned int offset;
+    void *ptr = arena_alloc_aligned(arena, size, alignment);
+    if (ptr != NULL)
+    {
+        ARENA_TRACE(ARENA_EVENT_ALLOC, arena, ptr, size, alignment, file, line);
+    }
+    return ptr;
+}
 
-    if (size == 0)
+
+void* arena_calloc_at(Arena *arena, size_t count, size_t size, const char *file, int line)
+{
+    void *ptr = arena_calloc(arena, count, size);
+    if (ptr != NULL)
     {
-        return NULL;
+        ARENA_TRACE(ARENA_EVENT_ALLOC, arena, ptr, count * size, ARENA_DEFAULT_ALIGNMENT, file, line);
     }
+    return ptr;
+}
 
-    if (arena == NULL || arena->region == NULL)
+
+void* arena_calloc_aligned_at(Arena *arena, size_t count, size_t size, unsigned int alignment,
+                              const char *file, int line)
+{
+    void *ptr = arena_calloc_aligned(arena, count, size, alignment);
+    if (ptr != NULL)
     {
-        return NULL;
+        ARENA_TRACE(ARENA_EVENT_ALLOC, arena, ptr, count * size, alignment, file, line);
     }
+    return ptr;
+}
 
-    if (alignment != 0)
+
+Arena* arena_expand_at(Arena *arena, size_t size, const char *file, int line)
+{
+    arena = arena_expand(arena, size);
+    if (arena != NULL)
     {
-        offset = (size_t)(arena->region + arena->index) % alignment;
-        if (offset > 0)
-        {
-            arena->index = arena->index - offset + alignment;
-        }
+        ARENA_TRACE(ARENA_EVENT_EXPAND, arena, arena->region, arena->size, 0, file, line);
     }
-    else
+    return arena;
+}
+
+
+void arena_clear_at(Arena *arena, const char *file, int line)
+{
+    if (arena != NULL)
     {
-        offset = 0;
+        ARENA_TRACE(ARENA_EVENT_CLEAR, arena, arena->region, arena->index, 0, file, line);
     }
+    arena_clear(arena);
+}
+
 
-    if (arena->size - (arena->index + offset) < size)
+void arena_destroy_at(Arena *arena, const char *file, int line)
+{
+    if (arena != NULL)
     {
-        return NULL;
+        ARENA_TRACE(ARENA_EVENT_DESTROY, arena, arena->region, arena->size, 0, file, line);
     }
+    arena_destroy(arena);
+}
 
-    #ifdef ARENA_DEBUG
-    arena_add_allocation(arena, size);
-    #endif /* ARENA_DEBUG */
+#endif /* ARENA_TRACE_LOCATION */
 
-    arena->index += size;
-    return arena->region + (arena->index - size);
+
+#ifdef ARENA_STATS
+
+void arena_reset_stats(Arena *arena)
+{
+    if (arena == NULL)
+    {
+        return;
+    }
+
+    arena->stats.peak = 0;
+    arena->stats.requested = 0;
+    arena->stats.padding = 0;
+    arena->stats.failures = 0;
+    arena->stats.expansions = 0;
 }
 
+#endif /* ARENA_STATS */
 
-size_t arena_copy(Arena *dest, Arena *src)
+
+#ifdef ARENA_GUARD
+
+void arena_guard(Arena *arena)
 {
-    size_t bytes;
+    if (arena == NULL || arena->index != 0 || arena->blocks != NULL
+        || (arena->flags & (ARENA_FLAG_GUARD | ARENA_FLAG_MAPPED)))
+    {
+        return;
+    }
 
-    if (dest == NULL || src == NULL)
+    arena->flags |= ARENA_FLAG_GUARD;
+    ARENA_ASAN_POISON(arena->region, arena->size);
+}
+
+
+void* arena_guard_alloc(Arena *arena, size_t size, unsigned int alignment)
+{
+    char *region;
+    size_t committed;
+    size_t offset;
+    size_t previous;
+
+    if (arena == NULL || arena->region == NULL || size == 0)
     {
-        return 0;
+        return NULL;
     }
 
-    if (src->index < dest->size)
+    offset = ARENA_ALIGN_PADDING(arena->region + arena->index, alignment);
+
+    if (size > (size_t)-1 - ARENA_GUARD_OVERHEAD - alignment)
     {
-        bytes = src->index;
+        return NULL;
     }
-    else
+
+    if (arena->size - arena->index < offset || arena->size - arena->index - offset < size + ARENA_GUARD_OVERHEAD)
     {
-        bytes = dest->size;
+        region = arena->region;
+        committed = arena->size;
+
+        if (arena_reserve(arena, size + ARENA_GUARD_OVERHEAD + alignment) == NULL)
+        {
+            #ifdef ARENA_STATS
+            arena->stats.failures++;
+            #endif /* ARENA_STATS */
+
+            return NULL;
+        }
+
+        /* New blocks and newly committed pages start out addressable */
+        if (arena->region != region || arena->size != committed)
+        {
+            ARENA_ASAN_POISON(arena->region + arena->index, arena->size - arena->index);
+        }
+
+        offset = ARENA_ALIGN_PADDING(arena->region + arena->index, alignment);
     }
 
-    ARENA_MEMCPY(dest->region, src->region, bytes);
-    dest->index = bytes;
+    previous = arena->index;
+    ARENA_ASAN_UNPOISON(arena->region + previous, offset + size + ARENA_GUARD_OVERHEAD);
 
-    return bytes;
+    arena->index += offset;
+
+    #ifdef ARENA_DEBUG
+    arena_add_allocation(arena, size);
+    #endif /* ARENA_DEBUG */
+
+    arena->index += size;
+    ARENA_MEMSET(arena->region + arena->index, ARENA_GUARD_BYTE, ARENA_GUARD_SIZE);
+    ARENA_MEMCPY(arena->region + arena->index + ARENA_GUARD_SIZE, &previous, sizeof(size_t));
+    arena->index += ARENA_GUARD_OVERHEAD;
+
+    #ifdef ARENA_STATS
+    ARENA_STATS_RECORD(arena, size, offset);
+    #endif /* ARENA_STATS */
+
+    ARENA_TRACE_EVENT(ARENA_EVENT_ALLOC, arena, arena->region + previous + offset, size, alignment);
+    return arena->region + previous + offset;
 }
 
 
-void arena_clear(Arena *arena)
+void* arena_guard_check(Arena *arena)
 {
-    if (arena == NULL)
+    Arena_Block *block;
+    char *region;
+    size_t index;
+    size_t previous;
+    size_t i;
+
+    if (arena == NULL || !(arena->flags & ARENA_FLAG_GUARD))
     {
-        return;
+        return NULL;
     }
 
-    arena->index = 0;
+    region = arena->region;
+    index = arena->index;
+    block = arena->blocks;
 
-    #ifdef ARENA_DEBUG
-    arena_delete_allocation_list(arena);
-    #endif /* ARENA_DEBUG */
+    for (;;)
+    {
+        while (index != 0)
+        {
+            /* A ruined offset means the canary in front of it was overrun as well */
+            if (index < ARENA_GUARD_OVERHEAD)
+            {
+                return region;
+            }
+
+            ARENA_MEMCPY(&previous, region + index - sizeof(size_t), sizeof(size_t));
+            for (i = index - ARENA_GUARD_OVERHEAD; i < index - sizeof(size_t); i++)
+            {
+                if ((unsigned char)region[i] != ARENA_GUARD_BYTE)
+                {
+                    return region + index - ARENA_GUARD_OVERHEAD;
+                }
+            }
+
+            if (previous > index - ARENA_GUARD_OVERHEAD)
+            {
+                return region + index - ARENA_GUARD_OVERHEAD;
+            }
+
+            index = previous;
+        }
+
+        if (block == NULL)
+        {
+            return NULL;
+        }
+
+        region = block->region;
+        index = block->index;
+        block = block->prev;
+    }
 }
 
 
-void arena_destroy(Arena *arena)
+void arena_guard_poison(Arena *arena, size_t index)
 {
-    if (arena == NULL)
+    if (arena == NULL || !(arena->flags & ARENA_FLAG_GUARD) || index > arena->index)
     {
         return;
     }
 
-    #ifdef ARENA_DEBUG
-    arena_delete_allocation_list(arena);
-    #endif /* ARENA_DEBUG */
-
-    if (arena->region != NULL)
+    /* Arenas kept zeroed have already been zeroed, which poisons them just as well */
+    if (!(arena->flags & ARENA_FLAG_ZERO))
     {
-        ARENA_FREE(arena->region);
+        ARENA_MEMSET(arena->region + index, ARENA_POISON_BYTE, arena->index - index);
     }
 
-    ARENA_FREE(arena);
+    ARENA_ASAN_POISON(arena->region + index, arena->size - index);
 }
 
+#endif /* ARENA_GUARD */
+
 
 #ifdef ARENA_DEBUG
 
 Arena_Allocation* arena_get_allocation_struct(Arena *arena, void *ptr)
 {
-    Arena_Allocation *current;
+    Arena_Block *block;
+    char *region;
+    size_t size;
+    size_t index;
+    unsigned long low;
+    unsigned long high;
 
     if (arena == NULL || ptr == NULL)
     {
         return NULL;
     }
 
-    current = arena->head_allocation;
-    while (current != NULL)
+    /* Find the block holding ptr, and the range of allocations made in it */
+    region = arena->region;
+    size = arena->size;
+    low = arena->blocks != NULL ? arena->blocks->allocations : 0;
+    high = arena->allocations;
+
+    block = arena->blocks;
+    while ((char *)ptr < region || (char *)ptr >= region + size)
+    {
+        if (block == NULL)
+        {
+            return NULL;
+        }
+
+        region = block->region;
+        size = block->size;
+        high = block->allocations;
+        low = block->prev != NULL ? block->prev->allocations : 0;
+        block = block->prev;
+    }
+
+    /* Allocations within a block are made at increasing indices */
+    index = (size_t)((char *)ptr - region);
+    while (low < high)
     {
-        if (current->pointer == (char *)ptr)
+        unsigned long middle = low + (high - low) / 2;
+        Arena_Allocation *allocation = ARENA_ALLOCATION_AT(arena, middle);
+
+        if (allocation->index == index)
+        {
+            return allocation;
+        }
+
+        if (allocation->index < index)
+        {
+            low = middle + 1;
+        }
+        else
         {
-            return current;
+            high = middle;
         }
-        current = current->next;
     }
 
     return NULL;
@@ -661,38 +5393,75 @@ Arena_Allocation* arena_get_allocation_struct(Arena *arena, void *ptr)
 
 void arena_add_allocation(Arena *arena, size_t size)
 {
+    Arena_Allocation *allocation;
+
     if (arena == NULL)
     {
         return;
     }
 
-    if (arena->head_allocation == NULL)
+    if (arena->allocations == arena->allocation_chunk_count * ARENA_ALLOCATION_CHUNK)
     {
-        arena->head_allocation = malloc(sizeof(Arena_Allocation));
-        arena->head_allocation->index = arena->index;
-        arena->head_allocation->size = size;
-        arena->head_allocation->pointer = arena->region + arena->index;
-        arena->head_allocation->next = NULL;
-    }
-    else
-    {
-        Arena_Allocation *current = arena->head_allocation;
-        while (current->next != NULL)
+        Arena_Allocation **chunks;
+        Arena_Allocation *chunk;
+
+        chunk = malloc(sizeof(Arena_Allocation) * ARENA_ALLOCATION_CHUNK);
+        if (chunk == NULL)
         {
-            current = current->next;
+            return;
         }
 
-        current->next = malloc(sizeof(Arena_Allocation));
-        current->next->index = arena->index;
-        current->next->size = size;
-        current->next->pointer = arena->region + arena->index;
-        current->next->next = NULL;
+        chunks = realloc(arena->allocation_chunks, sizeof(Arena_Allocation *) * (arena->allocation_chunk_count + 1));
+        if (chunks == NULL)
+        {
+            free(chunk);
+            return;
+        }
+
+        chunks[arena->allocation_chunk_count] = chunk;
+        arena->allocation_chunks = chunks;
+        arena->allocation_chunk_count++;
+    }
+
+    allocation = ARENA_ALLOCATION_AT(arena, arena->allocations);
+    allocation->index = arena->index;
+    allocation->size = size;
+    allocation->pointer = arena->region + arena->index;
+    allocation->next = NULL;
+
+    if (arena->allocations == 0)
+    {
+        arena->head_allocation = allocation;
+    }
+    else
+    {
+        ARENA_ALLOCATION_AT(arena, arena->allocations - 1)->next = allocation;
     }
 
     arena->allocations++;
 }
 
 
+void arena_trim_allocation_list(Arena *arena, unsigned long allocations)
+{
+    if (arena == NULL || allocations >= arena->allocations)
+    {
+        return;
+    }
+
+    /* The chunks are kept, since the scope is likely to be entered again */
+    arena->allocations = allocations;
+    if (arena->allocations == 0)
+    {
+        arena->head_allocation = NULL;
+    }
+    else
+    {
+        ARENA_ALLOCATION_AT(arena, arena->allocations - 1)->next = NULL;
+    }
+}
+
+
 void arena_delete_allocation_list(Arena *arena)
 {
     if (arena == NULL)
@@ -700,15 +5469,17 @@ void arena_delete_allocation_list(Arena *arena)
         return;
     }
 
-    while (arena->head_allocation != NULL)
+    while (arena->allocation_chunk_count > 0)
     {
-        Arena_Allocation *next = arena->head_allocation->next;
-        free(arena->head_allocation);
-        arena->head_allocation = next;
+        arena->allocation_chunk_count--;
+        free(arena->allocation_chunks[arena->allocation_chunk_count]);
     }
 
+    free(arena->allocation_chunks);
+
     arena->allocations = 0;
     arena->head_allocation = NULL;
+    arena->allocation_chunks = NULL;
 }
 
 #endif /* ARENA_DEBUG */
@@ -717,4 +5488,22 @@ void arena_delete_allocation_list(Arena *arena)
 #endif /* ARENA_IMPLEMENTATION */
 
 
+/*
+Defined last, so that none of the functions above are
+affected. Only calls made after including this header are
+wrapped.
+*/
+#ifdef ARENA_TRACE_LOCATION
+    #define arena_alloc(arena, size) arena_alloc_at(arena, size, __FILE__, __LINE__)
+    #define arena_alloc_aligned(arena, size, alignment) \
+        arena_alloc_aligned_at(arena, size, alignment, __FILE__, __LINE__)
+    #define arena_calloc(arena, count, size) arena_calloc_at(arena, count, size, __FILE__, __LINE__)
+    #define arena_calloc_aligned(arena, count, size, alignment) \
+        arena_calloc_aligned_at(arena, count, size, alignment, __FILE__, __LINE__)
+    #define arena_expand(arena, size) arena_expand_at(arena, size, __FILE__, __LINE__)
+    #define arena_clear(arena) arena_clear_at(arena, __FILE__, __LINE__)
+    #define arena_destroy(arena) arena_destroy_at(arena, __FILE__, __LINE__)
+#endif /* ARENA_TRACE_LOCATION */
+
+
 #endif /* ARENA_H */
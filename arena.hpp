@@ -0,0 +1,282 @@
+/*
+C++ helpers on top of arena.h, for handing arenas to
+standard containers and constructing objects in them. Only
+the declarations of arena.h are needed here, the
+implementation must still be defined in a C translation
+unit. Requires C++11, and C++17 for Arena_Resource.
+
+Nothing here runs destructors when an arena is cleared,
+rewound or destroyed. Objects that own anything outside of
+the arena must be destroyed by hand before then.
+*/
+
+#ifndef ARENA_HPP
+#define ARENA_HPP
+
+
+#include <cstddef>
+#include <new>
+#include <utility>
+
+#if __cplusplus >= 201703L && defined(__has_include)
+    #if __has_include(<memory_resource>)
+        #include <memory_resource>
+        #define ARENA_HAS_MEMORY_RESOURCE
+    #endif
+#endif
+
+#include "arena.h"
+
+
+/*
+Allocate from the arena, or throw std::bad_alloc the way
+the standard library expects allocators to. Chained arenas
+grow as usual.
+*/
+inline void* arena_alloc_or_throw(Arena *arena, std::size_t size, std::size_t alignment)
+{
+    void *ptr;
+
+    /* Standard library allocations of zero bytes must still succeed */
+    if (size == 0)
+    {
+        size = 1;
+    }
+
+    ptr = arena_alloc_aligned(arena, size, static_cast<unsigned int>(alignment));
+    if (ptr == nullptr)
+    {
+        throw std::bad_alloc();
+    }
+
+    return ptr;
+}
+
+
+/*
+Construct a T in the arena with the given arguments,
+aligned to alignof(T). Returns nullptr if the arena has no
+room, like arena_alloc.
+*/
+template <typename T, typename... Args>
+T* arena_make(Arena *arena, Args&&... args)
+{
+    void *ptr = arena_alloc_aligned(arena, sizeof(T), alignof(T));
+
+    if (ptr == nullptr)
+    {
+        return nullptr;
+    }
+
+    return new (ptr) T(std::forward<Args>(args)...);
+}
+
+
+/*
+An allocator for standard containers, such as
+std::vector<int, Arena_Allocator<int>>. Deallocation does
+nothing, the memory is reclaimed with the arena. Copies
+of an allocator, for any type, allocate from the same
+arena and compare equal.
+*/
+template <typename T>
+class Arena_Allocator
+{
+public:
+    typedef T value_type;
+
+    explicit Arena_Allocator(Arena *arena) noexcept : arena(arena)
+    {
+    }
+
+    template <typename U>
+    Arena_Allocator(const Arena_Allocator<U> &other) noexcept : arena(other.arena)
+    {
+    }
+
+    T* allocate(std::size_t count)
+    {
+        if (count > static_cast<std::size_t>(-1) / sizeof(T))
+        {
+            throw std::bad_alloc();
+        }
+
+        return static_cast<T *>(arena_alloc_or_throw(arena, count * sizeof(T), alignof(T)));
+    }
+
+    void deallocate(T *ptr, std::size_t count) noexcept
+    {
+        (void)ptr;
+        (void)count;
+    }
+
+    Arena *arena;
+};
+
+
+template <typename T, typename U>
+bool operator==(const Arena_Allocator<T> &a, const Arena_Allocator<U> &b) noexcept
+{
+    return a.arena == b.arena;
+}
+
+
+template <typename T, typename U>
+bool operator!=(const Arena_Allocator<T> &a, const Arena_Allocator<U> &b) noexcept
+{
+    return a.arena != b.arena;
+}
+
+
+#ifdef ARENA_HAS_MEMORY_RESOURCE
+
+/*
+A std::pmr::memory_resource backed by an arena, for
+std::pmr containers. Like Arena_Allocator, deallocation
+does nothing. Two resources are equal if they allocate
+from the same arena.
+*/
+class Arena_Resource : public std::pmr::memory_resource
+{
+public:
+    explicit Arena_Resource(Arena *arena) noexcept : arena(arena)
+    {
+    }
+
+    Arena *arena;
+
+private:
+    void* do_allocate(std::size_t bytes, std::size_t alignment) override
+    {
+        return arena_alloc_or_throw(arena, bytes, alignment);
+    }
+
+    void do_deallocate(void *ptr, std::size_t bytes, std::size_t alignment) override
+    {
+        (void)ptr;
+        (void)bytes;
+        (void)alignment;
+    }
+
+    bool do_is_equal(const std::pmr::memory_resource &other) const noexcept override
+    {
+        const Arena_Resource *resource = dynamic_cast<const Arena_Resource *>(&other);
+        return resource != nullptr && resource->arena == arena;
+    }
+};
+
+#endif /* ARENA_HAS_MEMORY_RESOURCE */
+
+
+/*
+An ARENA_FIXED arena with the region aligned to Alignment,
+so the padding for any power of two alignment up to that is
+computed from the index rather than the address. A size and
+alignment given as template arguments are checked against
+Capacity at compile time, leaving a single comparison at
+run time.
+*/
+template <std::size_t Capacity, std::size_t Alignment = alignof(std::max_align_t)>
+class Arena_Fixed
+{
+    static_assert(Capacity != 0, "Fixed arenas need a capacity");
+    static_assert(Alignment != 0 && (Alignment & (Alignment - 1)) == 0,
+                  "Fixed arenas must be aligned to a power of two");
+
+public:
+    Arena_Fixed() noexcept : index(0)
+    {
+    }
+
+    Arena_Fixed(const Arena_Fixed &) = delete;
+    Arena_Fixed& operator=(const Arena_Fixed &) = delete;
+
+    template <std::size_t Size, std::size_t Align = ARENA_DEFAULT_ALIGNMENT>
+    void* alloc() noexcept
+    {
+        static_assert(Size != 0 && Size <= Capacity, "The allocation can never fit");
+        static_assert((Align & (Align - 1)) == 0 && Align <= Alignment,
+                      "The alignment must be a power of two no greater than the arena's");
+
+        std::size_t offset = Align <= 1 ? 0 : (0 - index) & (Align - 1);
+        if (Capacity - index < offset + Size)
+        {
+            return nullptr;
+        }
+
+        index += offset + Size;
+        return region + (index - Size);
+    }
+
+    void* alloc(std::size_t size, std::size_t alignment = ARENA_DEFAULT_ALIGNMENT) noexcept
+    {
+        std::size_t offset;
+
+        if (size == 0)
+        {
+            return nullptr;
+        }
+
+        /* Only power of two alignments dividing the region's can be padded from the index */
+        if ((alignment & (alignment - 1)) == 0 && alignment <= Alignment)
+        {
+            offset = ARENA_ALIGN_PADDING(index, alignment);
+        }
+        else
+        {
+            offset = ARENA_ALIGN_PADDING(region + index, alignment);
+        }
+
+        if (Capacity - index < offset || Capacity - index - offset < size)
+        {
+            return nullptr;
+        }
+
+        index += offset + size;
+        return region + (index - size);
+    }
+
+    template <typename T, typename... Args>
+    T* make(Args&&... args)
+    {
+        void *ptr = alloc<sizeof(T), alignof(T)>();
+        return ptr == nullptr ? nullptr : new (ptr) T(std::forward<Args>(args)...);
+    }
+
+    void clear() noexcept
+    {
+        index = 0;
+    }
+
+    alignas(Alignment) char region[Capacity];
+    std::size_t index;
+};
+
+
+/*
+Marks the arena when constructed and rewinds it to the mark
+when it goes out of scope, giving back everything
+allocated in between.
+*/
+class Arena_Scope
+{
+public:
+    explicit Arena_Scope(Arena *arena) noexcept : arena(arena), marker(arena_mark(arena))
+    {
+    }
+
+    ~Arena_Scope()
+    {
+        arena_rewind(arena, marker);
+    }
+
+    Arena_Scope(const Arena_Scope &) = delete;
+    Arena_Scope& operator=(const Arena_Scope &) = delete;
+
+private:
+    Arena *arena;
+    Arena_Marker marker;
+};
+
+
+#endif /* ARENA_HPP */
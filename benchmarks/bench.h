@@ -0,0 +1,36 @@
+/* Timing and CSV output shared by the benchmarks */
+
+#ifndef BENCH_H
+#define BENCH_H
+
+#include <stdio.h> // printf
+#include <time.h>  // timespec_get
+
+// Every benchmark prints rows of:
+// benchmark,variant,size,alignment,threads,ns_per_op
+// `make bench` prints the header once, before the rows of all of them.
+
+
+// Results are folded into this so the work being timed cannot be optimized away
+static volatile unsigned long bench_sink;
+
+
+// Wall clock time in seconds, so that multi-threaded runs are not summed over threads
+static double bench_now(void)
+{
+    struct timespec now;
+    timespec_get(&now, TIME_UTC);
+    return (double)now.tv_sec + (double)now.tv_nsec * 1e-9;
+}
+
+
+static void bench_report(const char *benchmark, const char *variant, size_t size, unsigned int alignment,
+                         int threads, double start, unsigned long operations)
+{
+    double seconds = bench_now() - start;
+    printf("%s,%s,%zu,%u,%d,%.3f\n", benchmark, variant, size, alignment, threads,
+           seconds * 1e9 / (double)operations);
+}
+
+
+#endif // BENCH_H
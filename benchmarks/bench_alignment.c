@@ -0,0 +1,96 @@
+/* Per-allocation cost of the alignment math in arena_alloc and arena_alloc_aligned */
+
+#define ARENA_IMPLEMENTATION
+#include "../arena.h"
+#include "bench.h"
+
+#define ARENA_SIZE (1 << 20)
+#define ROUNDS 2000
+
+
+// The alignment math arena_alloc_aligned used before the power of two fast path
+void* modulo_alloc_aligned(Arena *arena, size_t size, unsigned int alignment);
+void* modulo_alloc_aligned(Arena *arena, size_t size, unsigned int alignment)
+{
+    size_t offset = 0;
+
+    if (alignment != 0)
+    {
+        offset = (size_t)(arena->region + arena->index) % alignment;
+        if (offset > 0)
+        {
+            offset = alignment - offset;
+        }
+    }
+
+    if (arena->size - arena->index < offset || arena->size - arena->index - offset < size)
+    {
+        return NULL;
+    }
+
+    arena->index += offset + size;
+    return arena->region + (arena->index - size);
+}
+
+
+// Keeps the alignment a runtime value, and both aligned paths out-of-line calls, the way other translation units see them
+static volatile unsigned int runtime_alignment = 8;
+static void* (*volatile before)(Arena *, size_t, unsigned int) = modulo_alloc_aligned;
+static void* (*volatile after)(Arena *, size_t, unsigned int) = arena_alloc_aligned;
+
+
+int main(void)
+{
+    Arena *arena = arena_create(ARENA_SIZE);
+    unsigned long allocations;
+    double start;
+    char *ptr;
+    int round;
+
+    allocations = 0;
+    start = bench_now();
+    for (round = 0; round < ROUNDS; round++)
+    {
+        unsigned int alignment = runtime_alignment;
+        void* (*alloc)(Arena *, size_t, unsigned int) = before;
+        arena_clear(arena);
+        while ((ptr = alloc(arena, 12, alignment)) != NULL)
+        {
+            *ptr = (char)allocations;
+            allocations++;
+        }
+    }
+    bench_report("alignment", "modulo", 12, runtime_alignment, 1, start, allocations);
+
+    allocations = 0;
+    start = bench_now();
+    for (round = 0; round < ROUNDS; round++)
+    {
+        unsigned int alignment = runtime_alignment;
+        void* (*alloc)(Arena *, size_t, unsigned int) = after;
+        arena_clear(arena);
+        while ((ptr = alloc(arena, 12, alignment)) != NULL)
+        {
+            *ptr = (char)allocations;
+            allocations++;
+        }
+    }
+    bench_report("alignment", "arena_alloc_aligned", 12, runtime_alignment, 1, start, allocations);
+
+    allocations = 0;
+    start = bench_now();
+    for (round = 0; round < ROUNDS; round++)
+    {
+        arena_clear(arena);
+        while ((ptr = arena_alloc(arena, 12)) != NULL)
+        {
+            *ptr = (char)allocations;
+            allocations++;
+        }
+    }
+    bench_report("alignment", "arena_alloc", 12, ARENA_DEFAULT_ALIGNMENT, 1, start, allocations);
+
+    arena_destroy(arena);
+
+    return 0;
+}
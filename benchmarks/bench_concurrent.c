@@ -0,0 +1,124 @@
+/* Arena_Concurrent and Arena_Local against malloc as the number of threads grows */
+
+#include <stdlib.h> // malloc, free
+
+#define ARENA_IMPLEMENTATION
+#include "../arena.h"
+#include "bench.h"
+
+#if defined(ARENA_HAS_ATOMICS) && !defined(__STDC_NO_THREADS__)
+
+#include <threads.h>
+
+#define MAX_THREADS 8
+#define PER_THREAD 2000000UL
+#define SIZE 32
+#define CHUNK_SIZE (64 << 10)
+#define BATCH 4096
+
+
+static Arena_Concurrent *shared;
+
+
+static int worker_concurrent(void *arg)
+{
+    unsigned long i;
+    char *ptr;
+
+    (void)arg;
+    for (i = 0; i < PER_THREAD; i++)
+    {
+        ptr = arena_concurrent_alloc(shared, SIZE);
+        *ptr = (char)i;
+    }
+    return 0;
+}
+
+
+static int worker_local(void *arg)
+{
+    Arena_Local local;
+    unsigned long i;
+    char *ptr;
+
+    (void)arg;
+    arena_local_init(&local, shared, CHUNK_SIZE);
+    for (i = 0; i < PER_THREAD; i++)
+    {
+        ptr = arena_local_alloc(&local, SIZE);
+        *ptr = (char)i;
+    }
+    return 0;
+}
+
+
+static int worker_malloc(void *arg)
+{
+    char *pointers[BATCH];
+    unsigned long i;
+    int j;
+
+    (void)arg;
+    for (i = 0; i < PER_THREAD; i += BATCH)
+    {
+        for (j = 0; j < BATCH; j++)
+        {
+            pointers[j] = malloc(SIZE);
+            *pointers[j] = (char)j;
+        }
+        for (j = 0; j < BATCH; j++)
+        {
+            free(pointers[j]);
+        }
+    }
+    return 0;
+}
+
+
+static void bench_threads(const char *variant, thrd_start_t worker, int count)
+{
+    thrd_t threads[MAX_THREADS];
+    double start;
+    int i;
+
+    // Sized so that neither variant runs out, with room for every local chunk's padding
+    shared = arena_concurrent_create((size_t)count * (PER_THREAD * SIZE + 2 * CHUNK_SIZE));
+
+    start = bench_now();
+    for (i = 0; i < count; i++)
+    {
+        thrd_create(&threads[i], worker, NULL);
+    }
+    for (i = 0; i < count; i++)
+    {
+        thrd_join(threads[i], NULL);
+    }
+    bench_report("threads", variant, SIZE, 0, count, start, (unsigned long)count * PER_THREAD);
+
+    arena_concurrent_destroy(shared);
+}
+
+
+int main(void)
+{
+    int count;
+
+    for (count = 1; count <= MAX_THREADS; count *= 2)
+    {
+        bench_threads("arena_concurrent_alloc", worker_concurrent, count);
+        bench_threads("arena_local_alloc", worker_local, count);
+        bench_threads("malloc", worker_malloc, count);
+    }
+
+    return 0;
+}
+
+#else
+
+// Nothing to measure without C11 atomics and threads
+int main(void)
+{
+    return 0;
+}
+
+#endif
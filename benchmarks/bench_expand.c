@@ -0,0 +1,78 @@
+/* Growing an arena from a small start to TARGET bytes in each of the ways it can grow */
+
+#define ARENA_IMPLEMENTATION
+#include "../arena.h"
+#include "bench.h"
+
+#define START_SIZE (4 << 10)
+#define TARGET (64 << 20)
+#define ALLOCATION (4 << 10)
+#define STEP (1 << 20)
+#define ROUNDS 20
+
+
+// Allocates until TARGET bytes are in use, calling arena_expand on each failure when a step is given
+static void bench_growth(const char *variant, Arena *(*create)(void), size_t step, int doubling)
+{
+    unsigned long operations = 0;
+    double start;
+    Arena *arena;
+    char *ptr;
+    int round;
+    size_t used;
+
+    start = bench_now();
+    for (round = 0; round < ROUNDS; round++)
+    {
+        arena = create();
+        for (used = 0; used < TARGET; used += ALLOCATION)
+        {
+            ptr = arena_alloc(arena, ALLOCATION);
+            if (ptr == NULL)
+            {
+                arena = arena_expand(arena, doubling ? arena->size * 2 : arena->size + step);
+                ptr = arena_alloc(arena, ALLOCATION);
+            }
+            *ptr = (char)used;
+            operations++;
+        }
+        bench_sink += (unsigned long)arena->size;
+        arena_destroy(arena);
+    }
+    bench_report("expand", variant, ALLOCATION, ARENA_DEFAULT_ALIGNMENT, 1, start, operations);
+}
+
+
+static Arena* create_heap(void)
+{
+    return arena_create(START_SIZE);
+}
+
+static Arena* create_inline(void)
+{
+    return arena_create_inline(START_SIZE);
+}
+
+static Arena* create_chained(void)
+{
+    return arena_create_chained(START_SIZE, 2);
+}
+
+static Arena* create_virtual(void)
+{
+    return arena_create_virtual(TARGET, 0);
+}
+
+
+int main(void)
+{
+    bench_growth("expand_double", create_heap, 0, 1);
+    bench_growth("expand_step", create_heap, STEP, 0);
+    bench_growth("expand_inline_double", create_inline, 0, 1);
+
+    // These never fail an allocation, so arena_expand is never called
+    bench_growth("chained", create_chained, 0, 0);
+    bench_growth("virtual", create_virtual, 0, 0);
+
+    return 0;
+}
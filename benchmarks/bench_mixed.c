@@ -0,0 +1,123 @@
+/* Mixed-size workloads, and the cost of an arena_clear cycle for each kind of arena */
+
+#include <stdlib.h> // malloc, free
+
+#define ARENA_IMPLEMENTATION
+#include "../arena.h"
+#include "bench.h"
+
+#define BATCH 4096
+#define ROUNDS 1000
+#define MAX_SIZE 512
+#define CYCLE_BYTES (1 << 20)
+#define CYCLES 2000
+
+
+// A fixed sequence of sizes from 1 to MAX_SIZE, the same for every variant
+static size_t batch_sizes[BATCH];
+
+static void make_sizes(void)
+{
+    unsigned long state = 12345;
+    int i;
+
+    for (i = 0; i < BATCH; i++)
+    {
+        state = state * 1103515245UL + 12345UL;
+        batch_sizes[i] = 1 + (state >> 16) % MAX_SIZE;
+    }
+}
+
+
+static void bench_mixed_arena(void)
+{
+    Arena *arena = arena_create(BATCH * MAX_SIZE + BATCH * 16);
+    double start;
+    char *ptr;
+    int round;
+    int i;
+
+    start = bench_now();
+    for (round = 0; round < ROUNDS; round++)
+    {
+        for (i = 0; i < BATCH; i++)
+        {
+            ptr = arena_alloc(arena, batch_sizes[i]);
+            *ptr = (char)i;
+        }
+        arena_clear(arena);
+    }
+    bench_report("mixed", "arena_alloc", MAX_SIZE, ARENA_DEFAULT_ALIGNMENT, 1, start, (unsigned long)ROUNDS * BATCH);
+
+    arena_destroy(arena);
+}
+
+
+static void bench_mixed_heap(void)
+{
+    static char *pointers[BATCH];
+    double start;
+    int round;
+    int i;
+
+    start = bench_now();
+    for (round = 0; round < ROUNDS; round++)
+    {
+        for (i = 0; i < BATCH; i++)
+        {
+            pointers[i] = malloc(batch_sizes[i]);
+            *pointers[i] = (char)i;
+        }
+        for (i = 0; i < BATCH; i++)
+        {
+            free(pointers[i]);
+        }
+    }
+    bench_report("mixed", "malloc", MAX_SIZE, 0, 1, start, (unsigned long)ROUNDS * BATCH);
+}
+
+
+// Fills CYCLE_BYTES in 64 byte allocations and clears, CYCLES times
+static void bench_clear_cycle(const char *variant, Arena *arena)
+{
+    double start;
+    char *ptr;
+    int cycle;
+    int i;
+
+    start = bench_now();
+    for (cycle = 0; cycle < CYCLES; cycle++)
+    {
+        for (i = 0; i < CYCLE_BYTES / 64; i++)
+        {
+            ptr = arena_alloc(arena, 64);
+            *ptr = (char)i;
+        }
+        arena_clear(arena);
+    }
+    bench_report("clear_cycle", variant, CYCLE_BYTES, ARENA_DEFAULT_ALIGNMENT, 1, start, CYCLES);
+
+    arena_destroy(arena);
+}
+
+
+int main(void)
+{
+    Arena *zeroed;
+
+    make_sizes();
+    bench_mixed_arena();
+    bench_mixed_heap();
+
+    bench_clear_cycle("flat", arena_create(CYCLE_BYTES));
+    bench_clear_cycle("chained", arena_create_chained(CYCLE_BYTES / 16, 2));
+
+    zeroed = arena_create(CYCLE_BYTES);
+    arena_keep_zeroed(zeroed);
+    bench_clear_cycle("zeroed", zeroed);
+
+    bench_clear_cycle("virtual", arena_create_virtual(CYCLE_BYTES * 2, 0));
+    bench_clear_cycle("virtual_decommit", arena_create_virtual(CYCLE_BYTES * 2, ARENA_FLAG_DECOMMIT));
+
+    return 0;
+}
@@ -0,0 +1,90 @@
+/* arena_alloc and arena_alloc_aligned against malloc/free across sizes and alignments */
+
+#include <stdlib.h> // malloc, free, aligned_alloc
+
+#define ARENA_IMPLEMENTATION
+#include "../arena.h"
+#include "bench.h"
+
+#define ARENA_SIZE (16 << 20)
+#define OPERATIONS 1000000UL
+#define BATCH 4096
+
+
+static const size_t sizes[] = {8, 64, 512, 4096};
+static const unsigned int alignments[] = {1, 8, 16, 64};
+
+
+// Allocates OPERATIONS times from an arena that is cleared whenever it fills up
+static void bench_arena(Arena *arena, size_t size, unsigned int alignment, int aligned)
+{
+    unsigned long operations;
+    double start;
+    char *ptr;
+
+    arena_clear(arena);
+    start = bench_now();
+    for (operations = 0; operations < OPERATIONS; operations++)
+    {
+        ptr = aligned ? arena_alloc_aligned(arena, size, alignment) : arena_alloc(arena, size);
+        if (ptr == NULL)
+        {
+            arena_clear(arena);
+            ptr = aligned ? arena_alloc_aligned(arena, size, alignment) : arena_alloc(arena, size);
+        }
+        *ptr = (char)operations;
+    }
+    bench_report("sizes", aligned ? "arena_alloc_aligned" : "arena_alloc", size,
+                 aligned ? alignment : ARENA_DEFAULT_ALIGNMENT, 1, start, operations);
+    bench_sink += (unsigned long)arena->index;
+}
+
+
+// The same pattern with the heap: BATCH allocations, then all of them freed
+static void bench_heap(size_t size, unsigned int alignment)
+{
+    static char *pointers[BATCH];
+    unsigned long operations;
+    double start;
+    int i;
+
+    // aligned_alloc wants the size to be a multiple of the alignment
+    size_t rounded = (size + alignment - 1) / alignment * alignment;
+
+    start = bench_now();
+    for (operations = 0; operations < OPERATIONS; operations += BATCH)
+    {
+        for (i = 0; i < BATCH; i++)
+        {
+            pointers[i] = alignment > 16 ? aligned_alloc(alignment, rounded) : malloc(size);
+            *pointers[i] = (char)i;
+        }
+        for (i = 0; i < BATCH; i++)
+        {
+            free(pointers[i]);
+        }
+    }
+    bench_report("sizes", alignment > 16 ? "aligned_alloc" : "malloc", size, alignment, 1, start, operations);
+}
+
+
+int main(void)
+{
+    Arena *arena = arena_create(ARENA_SIZE);
+    size_t s;
+    size_t a;
+
+    for (s = 0; s < sizeof(sizes) / sizeof(*sizes); s++)
+    {
+        bench_arena(arena, sizes[s], 0, 0);
+        for (a = 0; a < sizeof(alignments) / sizeof(*alignments); a++)
+        {
+            bench_arena(arena, sizes[s], alignments[a], 1);
+            bench_heap(sizes[s], alignments[a]);
+        }
+    }
+
+    arena_destroy(arena);
+
+    return 0;
+}
@@ -27,16 +27,41 @@
 //
 //     TEST_ARRAY_EQUAL(a, b, s) | TEST_ARRAY_EQUAL will fail if any elements differ
 
+/* mmap's flags are hidden by strict -std modes without this */
+#define _DEFAULT_SOURCE
 #include "test.h"
 
 
+/* Records the last event traced, for the tracing tests */
+static int trace_event = -1;
+static void *trace_ptr;
+static size_t trace_size;
+static unsigned long trace_count;
+#define ARENA_TRACE(event, arena, ptr, size, alignment, file, line)              \
+    (trace_event = (int)(event), trace_ptr = (void *)(ptr), trace_size = (size), \
+     trace_count++, (void)(arena), (void)(alignment), (void)(file), (void)(line))
+
+
+/* Records the last overwritten canary reported, for the guard tests */
+static unsigned long guard_failures;
+static void *guard_pointer;
+#define ARENA_GUARD_FAIL(arena, pointer) (guard_failures++, guard_pointer = (pointer), (void)(arena))
+
+
 #define ARENA_DEBUG
+#define ARENA_STATS
+#define ARENA_GUARD
 #define ARENA_IMPLEMENTATION
 #define ARENA_SUPPRESS_MALLOC_WARN
 #define ARENA_DEFAULT_ALIGNMENT 0
 #include "arena.h"
 
 
+#ifndef __STDC_NO_THREADS__
+#include <threads.h>
+#endif
+
+
 void test_arena_create(void)
 {
     Arena *arena = arena_create(0);
@@ -52,15 +77,270 @@ void test_arena_create(void)
 }
 
 
+void test_arena_create_chained(void)
+{
+    Arena *arena = arena_create_chained(16, 2);
+    char *first;
+    char *second;
+    char *large;
+
+    TEST_NULL(arena_create_chained(0, 2));
+    TEST_NULL(arena_create_chained(16, 0));
+
+    TEST_FATAL(arena != NULL, "Chained arena was NULL after creation. Fatal.");
+    TEST_EQUAL(arena->growth, 2);
+    TEST_NULL(arena->blocks);
+
+    first = arena_alloc(arena, 16);
+    TEST_FATAL(first != NULL, "First allocation from chained arena was NULL.");
+    memcpy(first, "Hello, world!!!\0", 16);
+
+    second = arena_alloc(arena, 8);
+    TEST_FATAL(second != NULL, "Allocation past the first block was NULL.");
+    TEST_NOT_NULL(arena->blocks);
+    TEST_EQUAL(arena->size, 32);
+    TEST_EQUAL(arena->index, 8);
+    TEST_ARRAY_EQUAL(first, "Hello, world!!!\0", 16);
+
+    large = arena_alloc(arena, 100);
+    TEST_NOT_NULL(large);
+    TEST_EQUAL(arena->size, 100);
+    TEST_EQUAL(arena->blocks->size, 32);
+    TEST_EQUAL(arena->blocks->prev->size, 16);
+
+    arena_clear(arena);
+    TEST_NULL(arena->blocks);
+    TEST_EQUAL(arena->size, 16);
+    TEST_EQUAL(arena->index, 0);
+
+    arena_alloc(arena, 20);
+    arena_destroy(arena);
+}
+
+
+void test_arena_create_inline(void)
+{
+    Arena *arena = arena_create_inline(0);
+    TEST_NULL(arena);
+    arena = arena_create_inline(32);
+    TEST_FATAL(arena != NULL, "Inline arena was NULL after creation. Fatal.");
+    TEST_EQUAL(arena->region, (char *)(arena + 1));
+    TEST_EQUAL(arena->size, 32);
+    TEST_EQUAL(arena->index, 0);
+    TEST_EQUAL(arena->flags, ARENA_FLAG_FREE_ARENA);
+    TEST_NOT_NULL(arena_alloc(arena, 32));
+    TEST_NULL(arena_alloc(arena, 1));
+    arena_destroy(arena);
+}
+
+
+void test_arena_create_from_buffer(void)
+{
+    char buffer[256];
+    Arena *arena = arena_create_from_buffer(buffer, sizeof(buffer));
+    char *ptr;
+
+    TEST_NULL(arena_create_from_buffer(NULL, sizeof(buffer)));
+    TEST_NULL(arena_create_from_buffer(buffer, sizeof(Arena)));
+
+    TEST_FATAL(arena != NULL, "Buffer arena was NULL after creation. Fatal.");
+    TEST_EQUAL((size_t)arena % ARENA_ALIGNOF(Arena), 0);
+    TEST_EQUAL(arena->region, (char *)(arena + 1));
+    TEST_EQUAL(arena->region + arena->size, buffer + sizeof(buffer));
+    TEST_EQUAL(arena->flags, 0);
+
+    ptr = arena_alloc(arena, 16);
+    TEST_NOT_NULL(ptr);
+    TEST_EQUAL((ptr >= buffer && ptr < buffer + sizeof(buffer)), 1);
+    TEST_NULL(arena_expand(arena, arena->size + 1));
+
+    /* Chained blocks are still freed, but the buffer is not */
+    arena_add_block(arena, 64);
+    arena_destroy(arena);
+}
+
+
+void test_arena_create_virtual(void)
+{
+    Arena *arena = arena_create_virtual(0, 0);
+    char *ptr;
+    char *region;
+
+    TEST_NULL(arena);
+    TEST_NULL(arena_create_virtual((size_t)-1, 0));
+
+    arena = arena_create_virtual((size_t)1 << 32, 0);
+    TEST_FATAL(arena != NULL, "Virtual arena was NULL after creation. Fatal.");
+    TEST_EQUAL(arena->region, (char *)(arena + 1));
+    TEST_EQUAL(arena->size, ARENA_COMMIT_SIZE - sizeof(Arena));
+    TEST_EQUAL(arena->flags, ARENA_FLAG_VIRTUAL);
+    TEST_EQUAL(arena->reserved % ARENA_COMMIT_SIZE, 0);
+    TEST_EQUAL((arena->reserved >= ((size_t)1 << 32)), 1);
+
+    /* Allocating past what is committed commits more in place */
+    region = arena->region;
+    ptr = arena_alloc(arena, 3 * ARENA_COMMIT_SIZE);
+    TEST_FATAL(ptr != NULL, "Allocation past the first commit step was NULL.");
+    ptr[3 * ARENA_COMMIT_SIZE - 1] = 1;
+    TEST_EQUAL(arena->region, region);
+    TEST_NULL(arena->blocks);
+    TEST_EQUAL(arena->size, 4 * ARENA_COMMIT_SIZE - sizeof(Arena));
+
+    TEST_NULL(arena_alloc(arena, arena->reserved));
+    arena_destroy(arena);
+
+    arena = arena_create_virtual(1, ARENA_FLAG_HUGE_PAGES | ARENA_FLAG_FREE_REGION);
+    TEST_FATAL(arena != NULL, "Huge page virtual arena was NULL after creation. Fatal.");
+    TEST_EQUAL(arena->flags, (ARENA_FLAG_VIRTUAL | ARENA_FLAG_HUGE_PAGES));
+    TEST_EQUAL((size_t)arena % ARENA_HUGE_PAGE_SIZE, 0);
+    TEST_EQUAL(arena->reserved, ARENA_HUGE_PAGE_SIZE);
+    TEST_NOT_NULL(arena_alloc(arena, 1024));
+    arena_destroy(arena);
+}
+
+
+void test_arena_commit(void)
+{
+    Arena *arena = arena_create_virtual(ARENA_COMMIT_SIZE * 8, 0);
+    Arena *heap = arena_create(16);
+
+    TEST_FATAL(arena != NULL, "Virtual arena was NULL after creation. Fatal.");
+    TEST_NULL(arena_commit(NULL, 16));
+    TEST_NULL(arena_commit(heap, 32));
+
+    TEST_EQUAL(arena_commit(arena, 16), arena);
+    TEST_EQUAL(arena->size, ARENA_COMMIT_SIZE - sizeof(Arena));
+
+    TEST_EQUAL(arena_commit(arena, ARENA_COMMIT_SIZE), arena);
+    TEST_EQUAL(arena->size, 2 * ARENA_COMMIT_SIZE - sizeof(Arena));
+    arena->region[arena->size - 1] = 1;
+
+    TEST_NULL(arena_commit(arena, arena->reserved));
+    TEST_EQUAL(arena_commit(arena, arena->reserved - sizeof(Arena)), arena);
+    TEST_EQUAL(arena->size, arena->reserved - sizeof(Arena));
+    arena->region[arena->size - 1] = 1;
+
+    arena_destroy(heap);
+    arena_destroy(arena);
+}
+
+
+void test_arena_decommit(void)
+{
+    Arena *arena = arena_create_virtual(ARENA_COMMIT_SIZE * 8, ARENA_FLAG_DECOMMIT);
+    char *ptr;
+
+    TEST_FATAL(arena != NULL, "Virtual arena was NULL after creation. Fatal.");
+    arena_decommit(NULL);
+
+    ptr = arena_alloc(arena, 2 * ARENA_COMMIT_SIZE);
+    TEST_FATAL(ptr != NULL, "Allocation from virtual arena was NULL.");
+    memset(ptr, 0xAB, 2 * ARENA_COMMIT_SIZE);
+
+    /* Only empty arenas are decommitted */
+    arena_decommit(arena);
+    TEST_EQUAL(arena->size, 3 * ARENA_COMMIT_SIZE - sizeof(Arena));
+
+    arena_clear(arena);
+    TEST_EQUAL(arena->size, ARENA_COMMIT_SIZE - sizeof(Arena));
+
+    /* Decommitted pages come back zeroed */
+    ptr = arena_alloc(arena, 2 * ARENA_COMMIT_SIZE);
+    TEST_FATAL(ptr != NULL, "Allocation after decommit was NULL.");
+    TEST_EQUAL(ptr[2 * ARENA_COMMIT_SIZE - 1], 0);
+    arena_destroy(arena);
+}
+
+
+void test_arena_current_node(void)
+{
+    int node = arena_current_node();
+
+    TEST_EQUAL((node >= 0), 1);
+    TEST_EQUAL((node < arena_node_count()), 1);
+}
+
+
+void test_arena_node_count(void)
+{
+    int count = arena_node_count();
+
+    TEST_EQUAL((count >= 1), 1);
+    TEST_EQUAL((count <= ARENA_MAX_NODES), 1);
+}
+
+
+void test_arena_bind_memory(void)
+{
+    char *memory = malloc(1 << 20);
+
+    TEST_FATAL(memory != NULL, "Memory to bind could not be allocated. Fatal.");
+
+    TEST_NULL(arena_bind_memory(NULL, 64, 0));
+    TEST_NULL(arena_bind_memory(memory, 0, 0));
+    TEST_NULL(arena_bind_memory(memory, 64, -1));
+    TEST_NULL(arena_bind_memory(memory, 64, ARENA_MAX_NODES));
+
+    #ifdef ARENA_NUMA_LINUX
+    /* The node the caller is on always exists, and less than a page has nothing to bind */
+    TEST_EQUAL(arena_bind_memory(memory, 1 << 20, arena_current_node()), memory);
+    TEST_EQUAL(arena_bind_memory(memory + 1, 8, arena_current_node()), memory + 1);
+    if (arena_node_count() < ARENA_MAX_NODES)
+    {
+        TEST_NULL(arena_bind_memory(memory, 1 << 20, ARENA_MAX_NODES - 1));
+    }
+    #else
+    TEST_NULL(arena_bind_memory(memory, 1 << 20, 0));
+    #endif /* ARENA_NUMA_LINUX */
+
+    /* Bound or not, the memory is as usable as before */
+    memset(memory, 1, 1 << 20);
+    TEST_EQUAL(memory[(1 << 20) - 1], 1);
+
+    free(memory);
+}
+
+
+void test_arena_bind_node(void)
+{
+    Arena *arena = arena_create(1 << 16);
+    Arena *virtual_arena = arena_create_virtual(ARENA_COMMIT_SIZE * 4, 0);
+
+    TEST_FATAL(arena != NULL, "Arena creation failed!");
+    TEST_FATAL(virtual_arena != NULL, "Virtual arena creation failed!");
+
+    TEST_NULL(arena_bind_node(NULL, 0));
+    TEST_NULL(arena_bind_node(arena, -1));
+
+    #ifdef ARENA_NUMA_LINUX
+    TEST_EQUAL(arena_bind_node(arena, arena_current_node()), arena);
+    TEST_EQUAL(arena_bind_node(virtual_arena, arena_current_node()), virtual_arena);
+    #endif /* ARENA_NUMA_LINUX */
+
+    /* Memory committed after binding is as usable as before */
+    TEST_NOT_NULL(arena_alloc(virtual_arena, ARENA_COMMIT_SIZE * 2));
+    TEST_NOT_NULL(arena_alloc(arena, 1 << 15));
+
+    arena_destroy(arena);
+    arena_destroy(virtual_arena);
+}
+
+
 void test_arena_expand(void)
 {
     Arena *arena = arena_create(6);
     char *ptr = arena_alloc(arena, 6);
+    Arena_Marker marker;
+    Arena_Block *block;
+
     memcpy(ptr, "Hello\0", 6);
     arena = arena_expand(arena, 12);
     TEST_EQUAL(arena->size, 12);
     TEST_EQUAL(arena->index, 6);
     TEST_ARRAY_EQUAL(arena->region, "Hello\0", 6);
+    TEST_EQUAL(trace_event, ARENA_EVENT_EXPAND);
+    TEST_EQUAL(trace_ptr, arena->region);
+    TEST_EQUAL(trace_size, 12);
 
     TEST_NULL(arena_expand(NULL, 0));
     TEST_NULL(arena_expand(arena, 0));
@@ -68,6 +348,222 @@ void test_arena_expand(void)
     TEST_NULL(arena_expand(arena, 12));
 
     arena_destroy(arena);
+
+    /* Chained arenas chain another block rather than moving theirs */
+    arena = arena_create_chained(8, 1);
+    arena_alloc(arena, 8);
+    ptr = arena_alloc(arena, 4);
+    TEST_FATAL(arena->blocks != NULL, "Chained arena did not chain a block.");
+    memcpy(ptr, "abc\0", 4);
+    marker = arena_mark(arena);
+    block = arena->blocks;
+    arena = arena_expand(arena, 16);
+    TEST_FATAL(arena != NULL, "Expanding a chained block failed.");
+    TEST_EQUAL(arena->size, 16);
+    TEST_EQUAL(arena->index, 0);
+    TEST_EQUAL(arena->blocks->prev, block);
+    TEST_EQUAL(arena->region, (char *)(arena->blocks + 1));
+    arena_alloc(arena, 8);
+    arena_rewind(arena, marker);
+    TEST_EQUAL(arena->blocks, block);
+    TEST_EQUAL(arena->index, 4);
+    TEST_ARRAY_EQUAL(ptr, "abc\0", 4);
+
+    arena_destroy(arena);
+
+    arena = arena_create_inline(6);
+    ptr = arena_alloc(arena, 6);
+    memcpy(ptr, "Hello\0", 6);
+    arena = arena_expand(arena, 12);
+    TEST_FATAL(arena != NULL, "Expanding an inline arena failed.");
+    TEST_EQUAL(arena->region, (char *)(arena + 1));
+    TEST_EQUAL(arena->size, 12);
+    TEST_ARRAY_EQUAL(arena->region, "Hello\0", 6);
+
+    arena_destroy(arena);
+
+    arena = arena_create_virtual(ARENA_COMMIT_SIZE * 4, 0);
+    ptr = arena->region;
+    TEST_EQUAL(arena_expand(arena, ARENA_COMMIT_SIZE * 2), arena);
+    TEST_EQUAL(arena->region, ptr);
+    TEST_EQUAL(arena->size, 3 * ARENA_COMMIT_SIZE - sizeof(Arena));
+    TEST_NULL(arena_expand(arena, ARENA_COMMIT_SIZE * 8));
+
+    arena_destroy(arena);
+}
+
+
+void test_arena_add_block(void)
+{
+    Arena *arena = arena_create(16);
+    char *region = arena->region;
+
+    TEST_NULL(arena_add_block(NULL, 16));
+    TEST_NULL(arena_add_block(arena, 0));
+
+    arena_alloc(arena, 10);
+    TEST_EQUAL(arena_add_block(arena, 4), arena);
+    TEST_FATAL(arena->blocks != NULL, "Arena had no blocks after adding one.");
+    TEST_EQUAL(arena->size, 16);
+    TEST_EQUAL(arena->index, 0);
+    TEST_EQUAL(arena->blocks->region, region);
+    TEST_EQUAL(arena->blocks->index, 10);
+    TEST_NULL(arena->blocks->prev);
+
+    TEST_EQUAL(trace_event, ARENA_EVENT_EXPAND);
+    TEST_EQUAL(trace_ptr, arena->region);
+    TEST_EQUAL(trace_size, 16);
+
+    TEST_EQUAL(arena_add_block(arena, 64), arena);
+    TEST_EQUAL(arena->size, 64);
+    TEST_FATAL(arena->blocks->prev != NULL, "Arena block list was not linked.");
+    TEST_EQUAL(arena->blocks->size, 16);
+
+    arena_destroy(arena);
+}
+
+
+void test_arena_pop_block(void)
+{
+    Arena *arena = arena_create(16);
+    char *region = arena->region;
+    char *kept;
+
+    arena_pop_block(NULL);
+    arena_pop_block(arena);
+    TEST_EQUAL(arena->region, region);
+
+    kept = arena_alloc(arena, 10);
+    arena_add_block(arena, 32);
+    arena_alloc(arena, 5);
+    arena_pop_block(arena);
+    TEST_NULL(arena->blocks);
+    TEST_EQUAL(arena->region, region);
+    TEST_EQUAL(arena->index, 10);
+    TEST_EQUAL(arena->size, 16);
+
+    /* The records made in the popped block go with it */
+    TEST_EQUAL(arena->allocations, 1);
+    TEST_NULL(arena->head_allocation->next);
+    TEST_EQUAL(arena_get_allocation_struct(arena, kept), arena->head_allocation);
+
+    arena_destroy(arena);
+}
+
+
+void test_arena_set_growth(void)
+{
+    Arena *arena = arena_create(16);
+    char *first;
+    char *ptr;
+
+    TEST_NULL(arena_set_growth(NULL, 2, 0));
+
+    /* Plain arenas chain once they have a growth */
+    first = arena_alloc(arena, 16);
+    TEST_NULL(arena_alloc(arena, 8));
+    TEST_EQUAL(arena_set_growth(arena, 2, 64), arena);
+    TEST_EQUAL(arena->growth, 2);
+    TEST_EQUAL(arena->growth_limit, 64);
+    ptr = arena_alloc(arena, 8);
+    TEST_NOT_NULL(ptr);
+    TEST_EQUAL(arena->size, 32);
+    TEST_EQUAL(arena->blocks->region, first);
+
+    /* Blocks double up to the limit, then stay at it */
+    arena->index = arena->size;
+    arena_alloc(arena, 1);
+    TEST_EQUAL(arena->size, 64);
+    arena->index = arena->size;
+    arena_alloc(arena, 1);
+    TEST_EQUAL(arena->size, 64);
+
+    /* Allocations bigger than the limit still get a block that fits */
+    arena_alloc(arena, 100);
+    TEST_EQUAL(arena->size, 100);
+    TEST_EQUAL(arena->growth_step, 64);
+
+    /* A growth of 1 steps by blocks of the same size */
+    arena_clear(arena);
+    TEST_EQUAL(arena->growth_step, 16);
+    arena_set_growth(arena, 1, 0);
+    arena->index = arena->size;
+    arena_alloc(arena, 1);
+    TEST_EQUAL(arena->size, 16);
+
+    /* Even after an oversized allocation, which gets a block of its own */
+    arena_alloc(arena, 1000);
+    TEST_EQUAL(arena->size, 1000);
+    arena->index = arena->size;
+    arena_alloc(arena, 1);
+    TEST_EQUAL(arena->size, 16);
+
+    /* Doubling carries on from the step, not from the oversized block */
+    arena_clear(arena);
+    arena_set_growth(arena, 2, 0);
+    arena_alloc(arena, 16);
+    arena_alloc(arena, 1000);
+    TEST_EQUAL(arena->size, 1000);
+    arena->index = arena->size;
+    arena_alloc(arena, 1);
+    TEST_EQUAL(arena->size, 64);
+
+    /* The step can be chosen directly */
+    arena_clear(arena);
+    arena_set_growth(arena, 1, 0);
+    arena->growth_step = 48;
+    arena->index = arena->size;
+    arena_alloc(arena, 1);
+    TEST_EQUAL(arena->size, 48);
+
+    /* A growth of zero stops it growing again */
+    arena_clear(arena);
+    arena_set_growth(arena, 0, 0);
+    TEST_NULL(arena_alloc(arena, 17));
+    TEST_NULL(arena->blocks);
+    arena_destroy(arena);
+
+    /* Virtual arenas chain only once the reservation is used up */
+    arena = arena_create_virtual(ARENA_COMMIT_SIZE * 2, 0);
+    arena_set_growth(arena, 1, 0);
+    TEST_NOT_NULL(arena_alloc(arena, ARENA_COMMIT_SIZE));
+    TEST_NULL(arena->blocks);
+    TEST_NOT_NULL(arena_alloc(arena, arena->reserved));
+    TEST_NOT_NULL(arena->blocks);
+    arena_clear(arena);
+    TEST_NULL(arena->blocks);
+    arena_destroy(arena);
+}
+
+
+void test_arena_reserve(void)
+{
+    Arena *arena = arena_create(16);
+
+    TEST_NULL(arena_reserve(NULL, 8));
+    TEST_NULL(arena_reserve(arena, 0));
+    TEST_EQUAL(arena_reserve(arena, 16), arena);
+    TEST_NULL(arena_reserve(arena, 17));
+    arena_destroy(arena);
+
+    arena = arena_create_chained(16, 2);
+    arena_alloc(arena, 12);
+    TEST_EQUAL(arena_reserve(arena, 4), arena);
+    TEST_NULL(arena->blocks);
+    TEST_EQUAL(arena_reserve(arena, 8), arena);
+    TEST_NOT_NULL(arena->blocks);
+    TEST_EQUAL(arena->size, 32);
+    TEST_EQUAL(arena->index, 0);
+    arena_destroy(arena);
+
+    arena = arena_create_virtual(ARENA_COMMIT_SIZE * 4, 0);
+    TEST_EQUAL(arena_reserve(arena, ARENA_COMMIT_SIZE * 2), arena);
+    TEST_NULL(arena->blocks);
+    TEST_EQUAL((arena->size >= ARENA_COMMIT_SIZE * 2), 1);
+    TEST_EQUAL(trace_event, ARENA_EVENT_EXPAND);
+    TEST_EQUAL(trace_size, arena->size);
+    TEST_NULL(arena_reserve(arena, ARENA_COMMIT_SIZE * 5));
+    arena_destroy(arena);
 }
 
 
@@ -128,80 +624,2211 @@ void test_arena_alloc_aligned(void)
 
     TEST_NULL(arena_alloc_aligned(arena, 100, 0));
 
+    arena_alloc_aligned(arena, 1, 0);
+    TEST_EQUAL(arena->index, 30);
+
+    arena_alloc_aligned(arena, 1, 1);
+    TEST_EQUAL(arena->index, 31);
+
+    /* Non-power of two alignments take the division path */
+    TEST_EQUAL((size_t)arena_alloc_aligned(arena, 1, 3) % 3, 0);
+
+    /* Successful allocations are traced, failures are not */
+    TEST_EQUAL(trace_event, ARENA_EVENT_ALLOC);
+    TEST_EQUAL(trace_ptr, arena->region + arena->index - 1);
+    TEST_EQUAL(trace_size, 1);
+    trace_count = 0;
+    TEST_NULL(arena_alloc_aligned(arena, 64, 1));
+    TEST_EQUAL(trace_count, 0);
+    TEST_EQUAL((size_t)arena_alloc_aligned(arena, 2, 12) % 12, 0);
+
+    /* A failed aligned allocation must not move the index */
+    arena->index = arena->size - 1;
+    TEST_NULL(arena_alloc_aligned(arena, 1, 16));
+    TEST_EQUAL(arena->index, arena->size - 1);
+
+    TEST_EQUAL(ARENA_ALIGN_PADDING(17, 16), 15);
+    TEST_EQUAL(ARENA_ALIGN_PADDING(32, 16), 0);
+    TEST_EQUAL(ARENA_ALIGN_PADDING(7, 6), 5);
+    TEST_EQUAL(ARENA_ALIGN_PADDING(12, 6), 0);
+    TEST_EQUAL(ARENA_ALIGN_PADDING(5, 0), 0);
+
     arena_destroy(arena);
 }
 
 
-void test_arena_copy(void)
+void test_arena_alloc_simd(void)
 {
-    Arena *arena_src = arena_create(1024);
-    Arena *arena_dest = arena_create(500);
-    char *src_array;
+    Arena *arena = arena_create(256);
+    char *ptr;
 
-    TEST_FATAL(arena_src != NULL, "Source arena creation failed!");
-    TEST_FATAL(arena_dest != NULL, "Destination arena creation failed!");
+    TEST_NULL(arena_alloc_simd(NULL, 16));
+    TEST_NULL(arena_alloc_simd(arena, 0));
 
-    TEST_EQUAL(arena_copy(NULL, arena_src), 0);
-    TEST_EQUAL(arena_copy(arena_dest, NULL), 0);
-    TEST_EQUAL(arena_copy(arena_dest, arena_src), 0);
+    arena_alloc(arena, 1);
+    ptr = arena_alloc_simd(arena, 24);
+    TEST_EQUAL(((size_t)ptr % ARENA_SIMD_ALIGNMENT), 0);
+    TEST_EQUAL(ptr + 24, arena->region + arena->index);
+    TEST_EQUAL((ARENA_SIMD_ALIGNMENT >= ARENA_ALIGNMENT_SSE), 1);
 
-    src_array = arena_alloc(arena_src, 3);
-    TEST_FATAL(src_array != NULL, "Source arena allocation failed!");
-    src_array[0] = 'a';
-    src_array[1] = 'b';
-    src_array[2] = 'c';
-    TEST_EQUAL(arena_copy(arena_dest, arena_src), 3);
-    TEST_ARRAY_EQUAL(arena_dest->region, arena_src->region, 3);
-    TEST_EQUAL(arena_dest->index, 3);
+    arena_destroy(arena);
+}
 
-    arena_src->index = arena_src->size;
-    TEST_EQUAL(arena_copy(arena_dest, arena_src), arena_dest->size);
-    TEST_EQUAL(arena_dest->size, arena_dest->index);
 
-    arena_destroy(arena_src);
-    arena_destroy(arena_dest);
+void test_arena_alloc_cache_line(void)
+{
+    Arena *arena = arena_create(ARENA_CACHE_LINE_SIZE * 5);
+    char *first;
+    char *second;
+
+    TEST_NULL(arena_alloc_cache_line(NULL, 8));
+    TEST_NULL(arena_alloc_cache_line(arena, 0));
+    TEST_NULL(arena_alloc_cache_line(arena, (size_t)-1));
+
+    /* Counters next to each other still get a line each */
+    arena_alloc(arena, 1);
+    first = arena_alloc_cache_line(arena, sizeof(unsigned long));
+    second = arena_alloc_cache_line(arena, sizeof(unsigned long));
+    TEST_EQUAL(((size_t)first % ARENA_CACHE_LINE_SIZE), 0);
+    TEST_EQUAL(second, first + ARENA_CACHE_LINE_SIZE);
+    TEST_EQUAL(arena->region + arena->index, second + ARENA_CACHE_LINE_SIZE);
+
+    /* Sizes that are already whole lines are not padded */
+    first = arena_alloc_cache_line(arena, ARENA_CACHE_LINE_SIZE);
+    TEST_EQUAL(first, second + ARENA_CACHE_LINE_SIZE);
+    TEST_EQUAL(arena->region + arena->index, first + ARENA_CACHE_LINE_SIZE);
+
+    arena_destroy(arena);
 }
 
 
-void test_arena_clear(void)
+typedef ARENA_FIXED(64) Test_Fixed_Arena;
+
+
+void test_arena_fixed_alloc(void)
 {
-    Arena *arena = arena_create(10);
-    arena->index = 5;
-    arena_clear(arena);
-    TEST_EQUAL(arena->index, 0);
+    static Test_Fixed_Arena global;
+    Test_Fixed_Arena scratch = {0};
+    size_t used;
+    char *ptr;
+
+    TEST_EQUAL(sizeof(scratch.region), 64);
+    TEST_NULL(ARENA_FIXED_ALLOC(scratch, 0, 1));
+    TEST_NULL(arena_fixed_alloc(NULL, &scratch.index, 64, 1, 1));
+    TEST_NULL(arena_fixed_alloc(scratch.region, NULL, 64, 1, 1));
+
+    ptr = ARENA_FIXED_ALLOC(scratch, 3, 1);
+    TEST_EQUAL(ptr, scratch.region);
+    TEST_EQUAL(scratch.index, 3);
+
+    ptr = ARENA_FIXED_ALLOC(scratch, 8, 16);
+    TEST_EQUAL(((size_t)ptr % 16), 0);
+    TEST_EQUAL(scratch.index, (size_t)(ptr - scratch.region) + 8);
+
+    /* Failures leave the index alone */
+    TEST_NULL(ARENA_FIXED_ALLOC(scratch, 64, 1));
+    TEST_EQUAL(scratch.index, (size_t)(ptr - scratch.region) + 8);
+    used = scratch.index;
+    TEST_EQUAL(ARENA_FIXED_ALLOC(scratch, 64 - used, 1), scratch.region + used);
+    TEST_EQUAL(scratch.index, 64);
+    TEST_NULL(ARENA_FIXED_ALLOC(scratch, 1, 1));
+
+    ARENA_FIXED_CLEAR(scratch);
+    TEST_EQUAL(ARENA_FIXED_ALLOC(scratch, 64, 1), scratch.region);
+
+    /* Static storage starts out empty */
+    TEST_EQUAL(ARENA_FIXED_ALLOC(global, 10, 1), global.region);
+}
+
+
+void test_arena_alloc_grow(void)
+{
+    Arena *arena = arena_create(16);
+    Arena *chained = arena_create_chained(16, 2);
+
+    TEST_NULL(arena_alloc_grow(NULL, 8, 0));
+    arena_alloc(arena, 12);
+    TEST_NULL(arena_alloc_grow(arena, 8, 0));
+    TEST_NULL(arena->blocks);
+
+    arena_alloc(chained, 12);
+    TEST_NOT_NULL(arena_alloc_grow(chained, 8, 4));
+    TEST_FATAL(chained->blocks != NULL, "Chained arena did not grow.");
+    TEST_EQUAL(chained->size, 32);
+    TEST_EQUAL(chained->index, 8);
+
     arena_destroy(arena);
+    arena_destroy(chained);
 }
 
 
-void test_arena_get_allocation_struct(void)
+void test_arena_realloc(void)
 {
     Arena *arena = arena_create(64);
-    char *ptr = arena_alloc(arena, 8);
-    char fake = 'a';
-    Arena_Allocation *allocation_struct = arena_get_allocation_struct(arena, ptr);
+    char *first;
+    char *second;
+    char *moved;
 
-    TEST_NULL(arena_get_allocation_struct(NULL, ptr));
-    TEST_NULL(arena_get_allocation_struct(arena, NULL));
+    TEST_NULL(arena_realloc(NULL, NULL, 0, 8));
+    TEST_NULL(arena_realloc(arena, NULL, 0, 0));
 
-    TEST_FATAL(arena != NULL, "Arena was NULL after creation.");
+    first = arena_realloc(arena, NULL, 0, 8);
+    TEST_FATAL(first != NULL, "Realloc of NULL did not allocate.");
+    memcpy(first, "abcdefgh", 8);
 
-    TEST_FATAL(ptr != NULL, "Pointer was NULL after creation.");
+    /* The tail grows and shrinks in place */
+    TEST_EQUAL(arena_realloc(arena, first, 8, 16), first);
+    TEST_EQUAL(trace_event, ARENA_EVENT_ALLOC);
+    TEST_EQUAL(trace_ptr, first + 8);
+    TEST_EQUAL(trace_size, 8);
+    TEST_EQUAL(arena->index, 16);
+    TEST_EQUAL(arena->head_allocation->size, 16);
+    TEST_EQUAL(arena_realloc(arena, first, 16, 4), first);
+    TEST_EQUAL(arena->index, 4);
+    TEST_EQUAL(arena->head_allocation->size, 4);
+    TEST_EQUAL(arena_realloc(arena, first, 4, 8), first);
 
-    TEST_FATAL(allocation_struct != NULL, "Allocation struct could not be found through pointer comparison.");
-    TEST_EQUAL(allocation_struct->index, 0);
-    TEST_EQUAL(allocation_struct->size, 8);
-    TEST_NULL(arena_get_allocation_struct(arena, &fake));
+    /* Anything else is copied when grown, and left alone when shrunk */
+    second = arena_alloc(arena, 8);
+    memcpy(second, "12345678", 8);
+    TEST_EQUAL(arena_realloc(arena, first, 8, 2), first);
+    TEST_EQUAL(arena->index, 16);
+    moved = arena_realloc(arena, first, 8, 12);
+    TEST_FATAL(moved != NULL, "Realloc of a non-tail allocation failed.");
+    TEST_EQUAL(trace_ptr, moved);
+    TEST_EQUAL(trace_size, 12);
+    TEST_EQUAL(moved, second + 8);
+    TEST_ARRAY_EQUAL(moved, "abcdefgh", 8);
+    TEST_EQUAL(arena->index, 28);
+
+    /* A tail that cannot grow in place still fails without moving the index */
+    TEST_NULL(arena_realloc(arena, moved, 12, 64));
+    TEST_EQUAL(arena->index, 28);
+
+    arena_destroy(arena);
+
+    /* Virtual arenas commit more of the reservation instead of copying */
+    arena = arena_create_virtual(ARENA_COMMIT_SIZE * 64, 0);
+    TEST_FATAL(arena != NULL, "Virtual arena creation failed.");
+    first = arena_alloc(arena, ARENA_COMMIT_SIZE / 2);
+    memcpy(first, "abcdefgh", 8);
+    TEST_EQUAL(arena_realloc(arena, first, ARENA_COMMIT_SIZE / 2, ARENA_COMMIT_SIZE * 8), first);
+    TEST_EQUAL(arena->index, ARENA_COMMIT_SIZE * 8);
+    TEST_EQUAL((arena->size >= ARENA_COMMIT_SIZE * 8), 1);
+    TEST_ARRAY_EQUAL(first, "abcdefgh", 8);
+    memset(first, 1, ARENA_COMMIT_SIZE * 8);
+    TEST_NULL(arena_realloc(arena, first, ARENA_COMMIT_SIZE * 8, ARENA_COMMIT_SIZE * 128));
+    TEST_EQUAL(arena->index, ARENA_COMMIT_SIZE * 8);
 
     arena_destroy(arena);
 }
 
 
-void test_arena_add_allocation(void)
+void test_arena_realloc_aligned(void)
 {
-    Arena *arena = arena_create(1024);
+    Arena *arena = arena_create(128);
+    char *first;
+    char *moved;
 
-    arena_alloc(arena, 10);
-    TEST_FATAL(arena->head_allocation != NULL, "Arena head allocation was NULL after first allocation.");
+    TEST_NULL(arena_realloc_aligned(NULL, NULL, 0, 8, 16));
+    TEST_NULL(arena_realloc_aligned(arena, NULL, 0, 0, 16));
+
+    arena_alloc(arena, 1);
+    first = arena_realloc_aligned(arena, NULL, 0, 8, 16);
+    TEST_FATAL(first != NULL, "Aligned realloc of NULL did not allocate.");
+    TEST_EQUAL(((size_t)first % 16), 0);
+    memcpy(first, "abcdefgh", 8);
+
+    TEST_EQUAL(arena_realloc_aligned(arena, first, 8, 24, 16), first);
+
+    /* Moving keeps the alignment */
+    arena_alloc(arena, 1);
+    moved = arena_realloc_aligned(arena, first, 24, 32, 16);
+    TEST_FATAL(moved != NULL, "Aligned realloc of a non-tail allocation failed.");
+    TEST_EQUAL(((size_t)moved % 16), 0);
+    TEST_ARRAY_EQUAL(moved, "abcdefgh", 8);
+
+    arena_destroy(arena);
+}
+
+
+void test_arena_calloc(void)
+{
+    Arena *arena = arena_create(64);
+    char *ptr;
+    int i;
+
+    TEST_NULL(arena_calloc(NULL, 4, 4));
+    TEST_NULL(arena_calloc(arena, 0, 4));
+    TEST_NULL(arena_calloc(arena, 4, 0));
+    TEST_NULL(arena_calloc(arena, (size_t)-1, 2));
+
+    memset(arena->region, 0xAB, 64);
+    ptr = arena_calloc(arena, 4, 8);
+    TEST_FATAL(ptr != NULL, "Zeroed allocation was NULL.");
+    TEST_EQUAL(ptr, arena->region);
+    TEST_EQUAL(arena->index, 32);
+    for (i = 0; i < 32; i++)
+    {
+        TEST_EQUAL(ptr[i], 0);
+    }
+    TEST_EQUAL((unsigned char)arena->region[32], 0xAB);
+
+    TEST_NULL(arena_calloc(arena, 33, 1));
+    arena_destroy(arena);
+}
+
+
+void test_arena_calloc_aligned(void)
+{
+    Arena *arena = arena_create(64);
+    char *ptr;
+    int i;
+
+    memset(arena->region, 0xAB, 64);
+    arena_alloc_aligned(arena, 3, 1);
+    ptr = arena_calloc_aligned(arena, 2, 5, 8);
+    TEST_FATAL(ptr != NULL, "Aligned zeroed allocation was NULL.");
+    TEST_EQUAL(((size_t)ptr % 8), 0);
+    for (i = 0; i < 10; i++)
+    {
+        TEST_EQUAL(ptr[i], 0);
+    }
+    TEST_EQUAL((unsigned char)ptr[10], 0xAB);
+
+    /* Zeroed arenas skip the memset, so untouched memory must already be zero */
+    arena_keep_zeroed(arena);
+    ptr = arena_calloc_aligned(arena, 4, 4, 4);
+    TEST_FATAL(ptr != NULL, "Aligned zeroed allocation from zeroed arena was NULL.");
+    for (i = 0; i < 16; i++)
+    {
+        TEST_EQUAL(ptr[i], 0);
+    }
+
+    arena_destroy(arena);
+}
+
+
+void test_arena_alloc_batch(void)
+{
+    Arena *arena = arena_create(64);
+    Arena_Request requests[3];
+    char *first;
+
+    requests[0].size = 3;
+    requests[0].alignment = 1;
+    requests[1].size = 8;
+    requests[1].alignment = 8;
+    requests[2].size = 2;
+    requests[2].alignment = 4;
+
+    TEST_NULL(arena_alloc_batch(NULL, requests, 3));
+    TEST_NULL(arena_alloc_batch(arena, NULL, 3));
+    TEST_NULL(arena_alloc_batch(arena, requests, 0));
+
+    trace_count = 0;
+    first = arena_alloc_batch(arena, requests, 3);
+    TEST_FATAL(first != NULL, "Batch allocation was NULL.");
+    TEST_EQUAL(trace_count, 3);
+    TEST_EQUAL(trace_event, ARENA_EVENT_ALLOC);
+    TEST_EQUAL(trace_ptr, arena->region + 16);
+    TEST_EQUAL(trace_size, 2);
+    TEST_EQUAL(first, arena->region);
+    TEST_EQUAL(requests[0].pointer, arena->region);
+    TEST_EQUAL(requests[1].pointer, arena->region + 8);
+    TEST_EQUAL(requests[2].pointer, arena->region + 16);
+    TEST_EQUAL(arena->index, 18);
+    TEST_EQUAL(arena->allocations, 3);
+    TEST_EQUAL(arena_get_allocation_struct(arena, requests[1].pointer)->size, 8);
+
+    /* A batch that does not fit leaves the arena as it was */
+    requests[1].size = 48;
+    TEST_NULL(arena_alloc_batch(arena, requests, 3));
+    TEST_EQUAL(arena->index, 18);
+    TEST_EQUAL(arena->allocations, 3);
+
+    requests[1].size = 0;
+    TEST_NULL(arena_alloc_batch(arena, requests, 3));
+
+    /* The worst case does not fit, but the exact layout does */
+    requests[0].size = 6;
+    requests[0].alignment = 2;
+    requests[1].size = 40;
+    requests[1].alignment = 1;
+    TEST_EQUAL(arena_alloc_batch(arena, requests, 2), arena->region + 18);
+    TEST_EQUAL(arena->index, 64);
+    arena_destroy(arena);
+
+    /* Chained arenas grow once for the whole batch */
+    arena = arena_create_chained(16, 1);
+    requests[0].size = 16;
+    requests[0].alignment = 8;
+    requests[1].size = 16;
+    requests[1].alignment = 8;
+    arena_alloc(arena, 1);
+    trace_count = 0;
+    first = arena_alloc_batch(arena, requests, 2);
+    TEST_FATAL(first != NULL, "Batch allocation from chained arena was NULL.");
+    TEST_EQUAL(trace_count, 3);
+    TEST_EQUAL(first, arena->region);
+    TEST_EQUAL(requests[1].pointer, arena->region + 16);
+    TEST_EQUAL(arena->blocks->prev, NULL);
+    arena_destroy(arena);
+}
+
+
+void test_arena_copy(void)
+{
+    Arena *arena_src = arena_create(1024);
+    Arena *arena_dest = arena_create(500);
+    Arena_Offset32 *first;
+    Arena_Offset32 *second;
+    char *src_array;
+
+    TEST_FATAL(arena_src != NULL, "Source arena creation failed!");
+    TEST_FATAL(arena_dest != NULL, "Destination arena creation failed!");
+
+    TEST_EQUAL(arena_copy(NULL, arena_src), 0);
+    TEST_EQUAL(arena_copy(arena_dest, NULL), 0);
+    TEST_EQUAL(arena_copy(arena_dest, arena_src), 0);
+
+    src_array = arena_alloc(arena_src, 3);
+    TEST_FATAL(src_array != NULL, "Source arena allocation failed!");
+    src_array[0] = 'a';
+    src_array[1] = 'b';
+    src_array[2] = 'c';
+    TEST_EQUAL(arena_copy(arena_dest, arena_src), 3);
+    TEST_ARRAY_EQUAL(arena_dest->region, arena_src->region, 3);
+    TEST_EQUAL(arena_dest->index, 3);
+
+    /* Links stored as offsets still lead to the same places in the copy */
+    first = arena_alloc_aligned(arena_src, sizeof(Arena_Offset32), ARENA_ALIGNOF(Arena_Offset32));
+    second = arena_alloc_aligned(arena_src, sizeof(Arena_Offset32), ARENA_ALIGNOF(Arena_Offset32));
+    *first = ARENA_OFFSET32(arena_src, second);
+    *second = ARENA_OFFSET32(arena_src, NULL);
+    TEST_EQUAL(ARENA_RESOLVE(arena_src, *first), second);
+    TEST_EQUAL(arena_copy(arena_dest, arena_src), arena_src->index);
+    first = ARENA_RESOLVE(arena_dest, ARENA_OFFSET(arena_src, first));
+    second = ARENA_RESOLVE(arena_dest, *first);
+    TEST_EQUAL(second, first + 1);
+    TEST_EQUAL(*second, ARENA_OFFSET_NULL);
+    TEST_NULL(ARENA_RESOLVE(arena_dest, *second));
+    TEST_EQUAL(ARENA_OFFSET(arena_src, arena_src->region), 1);
+
+    arena_src->index = arena_src->size;
+    TEST_EQUAL(arena_copy(arena_dest, arena_src), arena_dest->size);
+    TEST_EQUAL(arena_dest->size, arena_dest->index);
+
+    arena_destroy(arena_src);
+    arena_destroy(arena_dest);
+}
+
+
+#define TEST_IMAGE "test_arena_image.bin"
+
+
+void test_arena_copy_delta(void)
+{
+    Arena *src = arena_create(256);
+    Arena *dest = arena_create(256);
+    Arena_Marker marker;
+    char *first;
+    char *second;
+
+    TEST_EQUAL(arena_copy_delta(NULL, src), 0);
+    TEST_EQUAL(arena_copy_delta(dest, NULL), 0);
+
+    /* Nothing has been synced yet, so everything is copied */
+    first = arena_alloc(src, 16);
+    memset(first, 'a', 16);
+    TEST_EQUAL(arena_copy_delta(dest, src), 16);
+    TEST_ARRAY_EQUAL(dest->region, first, 16);
+    TEST_EQUAL(arena_copy_delta(dest, src), 0);
+
+    /* New allocations are copied without being touched */
+    second = arena_alloc(src, 8);
+    memset(second, 'b', 8);
+    TEST_EQUAL(arena_copy_delta(dest, src), 8);
+    TEST_EQUAL(dest->index, 24);
+    TEST_ARRAY_EQUAL((dest->region + 16), second, 8);
+
+    /* Writes to older allocations are only copied once touched */
+    first[4] = 'c';
+    arena_touch(src, first + 4);
+    arena_touch(src, dest->region);
+    TEST_EQUAL(arena_copy_delta(dest, src), 20);
+    TEST_EQUAL(dest->region[4], 'c');
+
+    /* Rewinding and allocating again copies the reused memory */
+    marker = arena_mark(src);
+    marker.index = 16;
+    arena_rewind(src, marker);
+    second = arena_alloc(src, 4);
+    memset(second, 'd', 4);
+    TEST_EQUAL(arena_copy_delta(dest, src), 4);
+    TEST_EQUAL(dest->index, 20);
+    TEST_ARRAY_EQUAL((dest->region + 16), "dddd", 4);
+
+    /* A full copy also counts as a sync */
+    second = arena_alloc(src, 2);
+    TEST_EQUAL(arena_copy(dest, src), 22);
+    TEST_EQUAL(arena_copy_delta(dest, src), 0);
+
+    arena_clear(src);
+    first = arena_alloc(src, 3);
+    memcpy(first, "xyz", 3);
+    TEST_EQUAL(arena_copy_delta(dest, src), 3);
+    TEST_EQUAL(dest->index, 3);
+    TEST_ARRAY_EQUAL(dest->region, "xyz", 3);
+
+    arena_destroy(src);
+    arena_destroy(dest);
+}
+
+
+void test_arena_touch(void)
+{
+    Arena *arena = arena_create(64);
+    char *ptr = arena_alloc(arena, 32);
+
+    arena_touch(NULL, ptr);
+    arena->dirty = 32;
+    arena_touch(arena, ptr + 32);
+    arena_touch(arena, ptr - 1);
+    TEST_EQUAL(arena->dirty, 32);
+    arena_touch(arena, ptr + 20);
+    TEST_EQUAL(arena->dirty, 20);
+    arena_touch(arena, ptr + 24);
+    TEST_EQUAL(arena->dirty, 20);
+
+    arena_destroy(arena);
+}
+
+
+void test_arena_fork(void)
+{
+    Arena *arena = arena_create(64);
+    Arena *aligned;
+    Arena *mapped;
+    Arena *fork;
+    char *ptr;
+
+    TEST_NULL(arena_fork(NULL));
+
+    ptr = arena_alloc(arena, 6);
+    memcpy(ptr, "Hello\0", 6);
+    fork = arena_fork(arena);
+    TEST_FATAL(fork != NULL, "Arena could not be forked. Fatal.");
+    TEST_EQUAL((fork->region == arena->region), 0);
+    TEST_EQUAL(fork->size, 64);
+    TEST_EQUAL(fork->index, 6);
+    TEST_ARRAY_EQUAL(fork->region, "Hello\0", 6);
+    fork->region[0] = 'J';
+    TEST_EQUAL(arena->region[0], 'H');
+    arena_destroy(fork);
+
+    /* Aligned allocations stay aligned in the fork, and after it grows */
+    aligned = arena_create(1024);
+    TEST_FATAL(aligned != NULL, "Arena creation failed!");
+    arena_alloc_aligned(aligned, 1, 1);
+    ptr = arena_alloc_aligned(aligned, 8, 256);
+    TEST_EQUAL(((size_t)ptr % 256), 0);
+    memcpy(ptr, "Hello\0", 6);
+    fork = arena_fork(aligned);
+    TEST_FATAL(fork != NULL, "Arena could not be forked. Fatal.");
+    TEST_EQUAL(((size_t)(fork->region + (ptr - aligned->region)) % 256), 0);
+    fork = arena_expand(fork, 4096);
+    TEST_FATAL(fork != NULL, "Fork could not be expanded. Fatal.");
+    TEST_EQUAL(((size_t)(fork->region + (ptr - aligned->region)) % 256), 0);
+    TEST_ARRAY_EQUAL((fork->region + (ptr - aligned->region)), "Hello\0", 6);
+    arena_destroy(fork);
+    arena_destroy(aligned);
+
+    /* Forks of read-only mappings are copy-on-write mappings of the same file */
+    TEST_FATAL(arena_save(arena, TEST_IMAGE) != NULL, "Arena could not be saved. Fatal.");
+    mapped = arena_map(TEST_IMAGE, 0);
+    TEST_FATAL(mapped != NULL, "Saved arena could not be mapped. Fatal.");
+    fork = arena_fork(mapped);
+    TEST_FATAL(fork != NULL, "Mapped arena could not be forked. Fatal.");
+    TEST_EQUAL(fork->index, 6);
+    TEST_EQUAL(((size_t)fork->region % ARENA_IMAGE_ALIGNMENT), ((size_t)mapped->region % ARENA_IMAGE_ALIGNMENT));
+    TEST_ARRAY_EQUAL(fork->region, "Hello\0", 6);
+    fork->region[0] = 'J';
+    TEST_EQUAL(mapped->region[0], 'H');
+
+    /* The fork outlives the arena it was forked from */
+    arena_destroy(mapped);
+    TEST_EQUAL(fork->region[0], 'J');
+    arena_destroy(fork);
+
+    remove(TEST_IMAGE);
+    arena_destroy(arena);
+}
+
+
+void test_arena_split(void)
+{
+    Arena *parent = arena_create(256);
+    Arena *child;
+    Arena_Marker marker;
+    char *ptr;
+
+    TEST_NULL(arena_split(NULL, 16));
+    TEST_NULL(arena_split(parent, 0));
+    TEST_NULL(arena_split(parent, 256));
+
+    arena_alloc_aligned(parent, 3, 1);
+    marker = arena_mark(parent);
+    child = arena_split(parent, 64);
+    TEST_FATAL(child != NULL, "Child arena was NULL after split. Fatal.");
+    TEST_EQUAL(((size_t)child % ARENA_ALIGNOF(Arena)), 0);
+    TEST_EQUAL(child->region, (char *)(child + 1));
+    TEST_EQUAL(child->size, 64);
+    TEST_EQUAL(child->index, 0);
+    TEST_EQUAL(child->flags, 0);
+    TEST_EQUAL(parent->region + parent->index, child->region + 64);
+
+    ptr = arena_alloc(child, 16);
+    TEST_EQUAL(ptr, child->region);
+    TEST_NULL(arena_alloc(child, 64));
+
+    /* Discarding the child gives everything back */
+    arena_destroy(child);
+    arena_rewind(parent, marker);
+    TEST_EQUAL(parent->index, 3);
+
+    arena_destroy(parent);
+}
+
+
+void test_arena_merge(void)
+{
+    Arena *parent = arena_create(1024);
+    Arena *child = arena_split(parent, 64);
+    Arena *other;
+    size_t index;
+    char *ptr;
+
+    TEST_NULL(arena_merge(NULL, child));
+    TEST_NULL(arena_merge(parent, NULL));
+
+    ptr = arena_alloc(child, 10);
+    memcpy(ptr, "Hello!!!!\0", 10);
+    TEST_EQUAL(arena_merge(parent, child), parent);
+    TEST_EQUAL(parent->index, sizeof(Arena) + 10);
+    TEST_EQUAL(parent->allocations, 1);
+    TEST_EQUAL(arena_get_allocation_struct(parent, child)->size, sizeof(Arena) + 10);
+    TEST_ARRAY_EQUAL(ptr, "Hello!!!!\0", 10);
+
+    /* A child that is no longer the last allocation keeps its memory */
+    child = arena_split(parent, 32);
+    TEST_FATAL(child != NULL, "Child arena was NULL after split. Fatal.");
+    other = arena_alloc(parent, 8);
+    TEST_EQUAL(arena_merge(parent, child), parent);
+    TEST_EQUAL(parent->region + parent->index, (char *)other + 8);
+
+    /* A chained child's region is in its own block, so it is refused */
+    child = arena_split(parent, 32);
+    TEST_FATAL(child != NULL, "Child arena was NULL after split. Fatal.");
+    arena_set_growth(child, 1, 0);
+    arena_alloc(child, 16);
+    TEST_NOT_NULL(arena_alloc(child, 32));
+    TEST_FATAL(child->blocks != NULL, "Child arena did not chain a block. Fatal.");
+    index = parent->index;
+    TEST_NULL(arena_merge(parent, child));
+    TEST_EQUAL(parent->index, index);
+    arena_destroy(child);
+
+    /* So is an arena that was never a child */
+    other = arena_create(32);
+    TEST_NULL(arena_merge(parent, other));
+    arena_destroy(other);
+
+    arena_destroy(parent);
+}
+
+
+void test_arena_save(void)
+{
+    Arena *arena = arena_create(64);
+    Arena_Image image;
+    FILE *file;
+    char *ptr;
+
+    TEST_NULL(arena_save(NULL, TEST_IMAGE));
+    TEST_NULL(arena_save(arena, NULL));
+    TEST_NULL(arena_save(arena, "no_such_directory/" TEST_IMAGE));
+
+    ptr = arena_alloc(arena, 6);
+    memcpy(ptr, "Hello\0", 6);
+    TEST_EQUAL(arena_save(arena, TEST_IMAGE), arena);
+
+    file = fopen(TEST_IMAGE, "rb");
+    TEST_FATAL(file != NULL, "Saved image could not be opened.");
+    TEST_EQUAL(fread(&image, sizeof(image), 1, file), 1);
+    TEST_ARRAY_EQUAL(image.magic, "ARENAIMG", 8);
+    TEST_EQUAL(image.index, 6);
+    TEST_EQUAL(image.offset % ARENA_IMAGE_ALIGNMENT, (size_t)arena->region % ARENA_IMAGE_ALIGNMENT);
+    fseek(file, 0, SEEK_END);
+    TEST_EQUAL((size_t)ftell(file), image.offset + 6);
+    fclose(file);
+
+    remove(TEST_IMAGE);
+    arena_destroy(arena);
+}
+
+
+void test_arena_map(void)
+{
+    Arena *arena = arena_create(256);
+    Arena_Marker marker;
+    Arena *mapped;
+    Arena *copy;
+    size_t *offsets;
+    char *text;
+    FILE *file;
+
+    TEST_NULL(arena_map(NULL, 0));
+    TEST_NULL(arena_map("no_such_file.bin", 0));
+
+    text = arena_alloc(arena, 6);
+    memcpy(text, "Hello\0", 6);
+    offsets = arena_alloc_aligned(arena, sizeof(size_t) * 2, 64);
+    offsets[0] = 0;
+    offsets[1] = (size_t)((char *)offsets - arena->region);
+    TEST_FATAL(arena_save(arena, TEST_IMAGE) != NULL, "Arena could not be saved. Fatal.");
+
+    mapped = arena_map(TEST_IMAGE, 0);
+    TEST_FATAL(mapped != NULL, "Saved arena could not be mapped. Fatal.");
+    TEST_EQUAL(mapped->index, arena->index);
+    TEST_EQUAL(mapped->size, arena->index);
+    TEST_EQUAL((mapped->flags & ARENA_FLAG_MAPPED), ARENA_FLAG_MAPPED);
+    TEST_ARRAY_EQUAL(mapped->region, "Hello\0", 6);
+
+    /* Offsets stay valid, and so does the alignment of what they point at */
+    offsets = (size_t *)(mapped->region + offsets[1]);
+    TEST_EQUAL(((size_t)offsets % 64), 0);
+    TEST_EQUAL(offsets[1], (size_t)((char *)offsets - mapped->region));
+    TEST_NULL(arena_alloc(mapped, 1));
+    TEST_NULL(arena_expand(mapped, 1024));
+
+    /* Clearing and rewinding would write to the read-only pages, so both are refused */
+    guard_failures = 0;
+    arena_clear(mapped);
+    TEST_EQUAL(mapped->index, arena->index);
+    TEST_EQUAL(guard_failures, 1);
+    TEST_EQUAL(guard_pointer, mapped->region);
+    marker = arena_mark(mapped);
+    marker.index = 0;
+    arena_rewind(mapped, marker);
+    TEST_EQUAL(mapped->index, arena->index);
+    TEST_EQUAL(guard_failures, 2);
+    guard_failures = 0;
+
+    /* Writes to a copy-on-write mapping stay out of the file and other mappings */
+    copy = arena_map(TEST_IMAGE, ARENA_FLAG_COPY_ON_WRITE);
+    TEST_FATAL(copy != NULL, "Saved arena could not be mapped copy-on-write. Fatal.");
+    copy->region[0] = 'J';
+    TEST_EQUAL(mapped->region[0], 'H');
+    arena_destroy(copy);
+
+    arena_destroy(mapped);
+
+    /* Anything that was not written by arena_save is refused */
+    file = fopen(TEST_IMAGE, "wb");
+    TEST_FATAL(file != NULL, "Test image could not be overwritten. Fatal.");
+    fputs("Not an arena image, but long enough to hold the image header anyway", file);
+    fclose(file);
+    TEST_NULL(arena_map(TEST_IMAGE, 0));
+
+    remove(TEST_IMAGE);
+    arena_destroy(arena);
+}
+
+
+void test_arena_mark(void)
+{
+    Arena *arena = arena_create(64);
+    Arena_Marker marker = arena_mark(NULL);
+
+    TEST_NULL(marker.block);
+    TEST_EQUAL(marker.index, 0);
+
+    arena_alloc(arena, 10);
+    marker = arena_mark(arena);
+    TEST_NULL(marker.block);
+    TEST_EQUAL(marker.index, 10);
+    TEST_EQUAL(marker.allocations, 1);
+
+    arena_add_block(arena, 32);
+    arena_alloc(arena, 3);
+    marker = arena_mark(arena);
+    TEST_EQUAL(marker.block, arena->blocks);
+    TEST_EQUAL(marker.index, 3);
+    TEST_EQUAL(marker.allocations, 2);
+
+    arena_destroy(arena);
+}
+
+
+void test_arena_rewind(void)
+{
+    Arena *arena = arena_create_chained(16, 1);
+    Arena_Marker start = arena_mark(arena);
+    Arena_Marker middle;
+    unsigned long generation;
+    char *kept;
+
+    arena_rewind(NULL, start);
+
+    kept = arena_alloc(arena, 4);
+    middle = arena_mark(arena);
+    arena_alloc(arena, 8);
+    arena_alloc(arena, 12);
+    TEST_FATAL(arena->blocks != NULL, "Chained arena did not chain a block.");
+    TEST_EQUAL(arena->allocations, 3);
+
+    arena_rewind(arena, middle);
+    TEST_NULL(arena->blocks);
+    TEST_EQUAL(arena->index, 4);
+    TEST_EQUAL(arena->allocations, 1);
+    TEST_FATAL(arena->head_allocation != NULL, "Rewind removed allocations before the marker.");
+    TEST_NULL(arena->head_allocation->next);
+    TEST_EQUAL(arena_get_allocation_struct(arena, kept), arena->head_allocation);
+
+    /* Rewinding forward must not resurrect released memory */
+    arena_alloc(arena, 2);
+    arena_rewind(arena, start);
+    arena_rewind(arena, middle);
+    TEST_EQUAL(arena->index, 0);
+    TEST_EQUAL(arena->allocations, 0);
+    TEST_NULL(arena->head_allocation);
+
+    /* Only releasing memory moves the generation on */
+    generation = arena->generation;
+    arena_rewind(arena, start);
+    TEST_EQUAL(arena->generation, generation);
+    arena_alloc(arena, 2);
+    arena_rewind(arena, start);
+    TEST_EQUAL(arena->generation, generation + 1);
+
+    arena_destroy(arena);
+}
+
+
+void test_arena_keep_zeroed(void)
+{
+    Arena *arena = arena_create_chained(32, 1);
+    Arena_Marker marker;
+    char *ptr;
+    int i;
+
+    arena_keep_zeroed(NULL);
+
+    memset(arena->region, 0xAB, 32);
+    ptr = arena_alloc(arena, 8);
+    arena_keep_zeroed(arena);
+    TEST_EQUAL((arena->flags & ARENA_FLAG_ZERO), ARENA_FLAG_ZERO);
+    TEST_EQUAL((unsigned char)ptr[7], 0xAB);
+    for (i = 8; i < 32; i++)
+    {
+        TEST_EQUAL(arena->region[i], 0);
+    }
+
+    /* Memory released by a rewind is zeroed */
+    marker = arena_mark(arena);
+    ptr = arena_alloc(arena, 16);
+    memset(ptr, 0xCD, 16);
+    arena_rewind(arena, marker);
+    for (i = 8; i < 32; i++)
+    {
+        TEST_EQUAL(arena->region[i], 0);
+    }
+
+    /* As is memory released by shrinking in place */
+    ptr = arena_alloc(arena, 16);
+    memset(ptr, 0xCD, 16);
+    TEST_EQUAL(arena_realloc(arena, ptr, 16, 4), ptr);
+    TEST_EQUAL(ptr[4], 0);
+    TEST_EQUAL(ptr[15], 0);
+
+    /* Chained blocks start zeroed */
+    ptr = arena_alloc(arena, 24);
+    TEST_FATAL(arena->blocks != NULL, "Chained arena did not chain a block.");
+    for (i = 0; i < 24; i++)
+    {
+        TEST_EQUAL(ptr[i], 0);
+    }
+
+    arena_destroy(arena);
+
+    arena = arena_create(8);
+    memset(arena->region, 0xAB, 8);
+    arena_keep_zeroed(arena);
+    arena = arena_expand(arena, 16);
+    TEST_FATAL(arena != NULL, "Expanding a zeroed arena failed.");
+    for (i = 0; i < 16; i++)
+    {
+        TEST_EQUAL(arena->region[i], 0);
+    }
+    arena_destroy(arena);
+}
+
+
+void test_arena_zero_used(void)
+{
+    Arena *arena = arena_create(16);
+    char *ptr;
+    int i;
+
+    arena_zero_used(NULL);
+
+    ptr = arena_alloc(arena, 8);
+    memset(arena->region, 0xAB, 16);
+    arena_zero_used(arena);
+    for (i = 0; i < 8; i++)
+    {
+        TEST_EQUAL(ptr[i], 0);
+    }
+    TEST_EQUAL((unsigned char)arena->region[8], 0xAB);
+    TEST_EQUAL(arena->index, 8);
+
+    /* arena_clear zeroes the used memory of zeroed arenas */
+    arena_keep_zeroed(arena);
+    ptr = arena_alloc(arena, 8);
+    memset(arena->region, 0xCD, 16);
+    arena_clear(arena);
+    for (i = 0; i < 16; i++)
+    {
+        TEST_EQUAL(arena->region[i], 0);
+    }
+    arena_destroy(arena);
+
+    arena = arena_create_virtual(ARENA_COMMIT_SIZE * 4, ARENA_FLAG_ZERO | ARENA_FLAG_DECOMMIT);
+    TEST_FATAL(arena != NULL, "Virtual arena was NULL after creation. Fatal.");
+    TEST_EQUAL((arena->flags & ARENA_FLAG_ZERO), ARENA_FLAG_ZERO);
+    ptr = arena_calloc(arena, 2, ARENA_COMMIT_SIZE);
+    TEST_FATAL(ptr != NULL, "Zeroed allocation from virtual arena was NULL.");
+    memset(ptr, 0xAB, 2 * ARENA_COMMIT_SIZE);
+    arena_clear(arena);
+    ptr = arena_calloc(arena, 2, ARENA_COMMIT_SIZE);
+    TEST_FATAL(ptr != NULL, "Zeroed allocation after decommit was NULL.");
+    TEST_EQUAL(ptr[0], 0);
+    TEST_EQUAL(ptr[ARENA_COMMIT_SIZE], 0);
+    TEST_EQUAL(ptr[2 * ARENA_COMMIT_SIZE - 1], 0);
+    arena_destroy(arena);
+}
+
+
+void test_arena_clear(void)
+{
+    Arena *arena = arena_create(10);
+    arena->index = 5;
+    arena_clear(arena);
+    TEST_EQUAL(arena->index, 0);
+    TEST_EQUAL(arena->generation, 1);
+
+    TEST_EQUAL(trace_event, ARENA_EVENT_CLEAR);
+    TEST_EQUAL(trace_ptr, arena->region);
+    TEST_EQUAL(trace_size, 5);
+
+    arena_destroy(arena);
+    TEST_EQUAL(trace_event, ARENA_EVENT_DESTROY);
+    TEST_EQUAL(trace_size, 10);
+}
+
+
+void test_arena_pool_init(void)
+{
+    Arena *arena = arena_create(256);
+    Arena_Pool pool;
+
+    arena_pool_init(NULL, arena, 16, 8);
+
+    arena_pool_init(&pool, arena, 0, 8);
+    TEST_NULL(pool.arena);
+    TEST_NULL(arena_pool_alloc(&pool));
+
+    arena_pool_init(&pool, arena, 1, 1);
+    TEST_EQUAL(pool.arena, arena);
+    TEST_NULL(pool.free_list);
+    TEST_EQUAL(pool.slot_size, sizeof(void *));
+    TEST_EQUAL(pool.alignment, ARENA_ALIGNOF(void *));
+
+    arena_destroy(arena);
+}
+
+
+void test_arena_pool_alloc(void)
+{
+    Arena *arena = arena_create(256);
+    Arena_Marker marker;
+    Arena_Pool pool;
+    char *first;
+    char *second;
+    char *ptr;
+
+    arena_pool_init(&pool, arena, 24, 8);
+    TEST_NULL(arena_pool_alloc(NULL));
+
+    first = arena_pool_alloc(&pool);
+    second = arena_pool_alloc(&pool);
+    TEST_FATAL(first != NULL && second != NULL, "Pool allocation failed.");
+    TEST_EQUAL((size_t)first % 8, 0);
+    TEST_EQUAL(second, first + 24);
+
+    /* Freed slots are reused, most recently freed first */
+    arena_pool_free(&pool, first);
+    arena_pool_free(&pool, second);
+    TEST_EQUAL(arena_pool_alloc(&pool), second);
+    TEST_EQUAL(arena_pool_alloc(&pool), first);
+    TEST_EQUAL(arena_pool_alloc(&pool), second + 24);
+
+    /* Clearing the arena drops the free list */
+    arena_pool_free(&pool, first);
+    arena_clear(arena);
+    TEST_EQUAL(arena_pool_alloc(&pool), (char *)arena->region + ARENA_ALIGN_PADDING(arena->region, 8));
+    TEST_NULL(pool.free_list);
+
+    /* So does rewinding past the freed slots, which the arena hands out again */
+    marker = arena_mark(arena);
+    first = arena_pool_alloc(&pool);
+    arena_pool_free(&pool, first);
+    arena_rewind(arena, marker);
+    ptr = arena_alloc_aligned(arena, 24, 8);
+    TEST_EQUAL(ptr, first);
+    second = arena_pool_alloc(&pool);
+    TEST_EQUAL((second >= ptr + 24 || second + 24 <= ptr), 1);
+    TEST_NULL(pool.free_list);
+
+    arena_destroy(arena);
+}
+
+
+void test_arena_pool_free(void)
+{
+    Arena *arena = arena_create(256);
+    Arena_Pool pool;
+    void *slot;
+
+    arena_pool_init(&pool, arena, 16, 8);
+    slot = arena_pool_alloc(&pool);
+
+    arena_pool_free(NULL, slot);
+    arena_pool_free(&pool, NULL);
+    TEST_NULL(pool.free_list);
+
+    arena_pool_free(&pool, slot);
+    TEST_EQUAL(pool.free_list, slot);
+
+    /* Stale slots from before a clear are ignored */
+    arena_clear(arena);
+    pool.free_list = NULL;
+    arena_pool_free(&pool, slot);
+    TEST_NULL(pool.free_list);
+
+    arena_destroy(arena);
+}
+
+
+void test_arena_classes_init(void)
+{
+    Arena *arena = arena_create(256);
+    Arena_Classes classes;
+
+    arena_classes_init(NULL, arena, 64);
+
+    arena_classes_init(&classes, arena, 0);
+    TEST_NULL(classes.arena);
+    TEST_NULL(arena_classes_alloc(&classes, 8, 8));
+
+    arena_classes_init(&classes, NULL, 64);
+    TEST_NULL(arena_classes_alloc(&classes, 8, 8));
+
+    arena_clear(arena);
+    arena_classes_init(&classes, arena, 64);
+    TEST_EQUAL(classes.arena, arena);
+    TEST_EQUAL(classes.chunk_size, 64);
+    TEST_EQUAL(classes.generation, arena->generation);
+    TEST_NULL(classes.regions[0]);
+    TEST_EQUAL(arena->index, 0);
+
+    arena_destroy(arena);
+}
+
+
+void test_arena_classes_alloc(void)
+{
+    Arena *arena = arena_create(1024);
+    Arena_Classes classes;
+    Arena_Marker marker;
+    char *string;
+    char *vector;
+    char *ptr;
+
+    arena_classes_init(&classes, arena, 128);
+    TEST_NULL(arena_classes_alloc(&classes, 0, 1));
+    TEST_NULL(arena_classes_alloc(NULL, 1, 1));
+
+    /* Strings and aligned buffers each stay packed in their own chunk */
+    string = arena_classes_alloc(&classes, 3, 1);
+    vector = arena_classes_alloc(&classes, 64, 64);
+    TEST_EQUAL(((size_t)vector % 64), 0);
+    TEST_EQUAL(arena_classes_alloc(&classes, 5, 1), string + 3);
+    TEST_EQUAL(arena_classes_alloc(&classes, 16, 32), vector + 64);
+    TEST_EQUAL(arena_classes_alloc(&classes, 2, 0), string + 8);
+
+    /* A full chunk is replaced by a new one */
+    ptr = arena_classes_alloc(&classes, 60, 1);
+    TEST_EQUAL(ptr, string + 10);
+    ptr = arena_classes_alloc(&classes, 60, 1);
+    TEST_EQUAL(ptr, classes.regions[0]);
+    TEST_EQUAL(classes.indices[0], 60);
+
+    /* Large sizes and unusual alignments bypass the chunks */
+    ptr = arena_classes_alloc(&classes, 65, 1);
+    TEST_EQUAL(ptr + 65, arena->region + arena->index);
+    ptr = arena_classes_alloc(&classes, 8, 128);
+    TEST_EQUAL(((size_t)ptr % 128), 0);
+    TEST_EQUAL(ptr + 8, arena->region + arena->index);
+    ptr = arena_classes_alloc(&classes, 6, 3);
+    TEST_EQUAL(((size_t)ptr % 3), 0);
+    TEST_EQUAL(ptr + 6, arena->region + arena->index);
+
+    /* Clearing the arena takes the chunks back */
+    arena_clear(arena);
+    ptr = arena_classes_alloc(&classes, 4, 1);
+    TEST_EQUAL(ptr, arena->region);
+    TEST_EQUAL(arena->index, 128);
+
+    /* Without room for another chunk, small allocations come from the arena */
+    arena->index = arena->size - 8;
+    ptr = arena_classes_alloc(&classes, 8, 8);
+    TEST_EQUAL(ptr, arena->region + arena->size - 8);
+
+    /* Rewinding past the chunks takes them back too, the arena hands that memory out again */
+    arena_clear(arena);
+    marker = arena_mark(arena);
+    TEST_NOT_NULL(arena_classes_alloc(&classes, 4, 8));
+    arena_rewind(arena, marker);
+    vector = arena_alloc(arena, 128);
+    ptr = arena_classes_alloc(&classes, 4, 8);
+    TEST_EQUAL((ptr >= vector + 128 || ptr + 4 <= vector), 1);
+
+    arena_destroy(arena);
+}
+
+
+void test_arena_cache_init(void)
+{
+    Arena_Cache cache;
+
+    arena_cache_init(NULL, 1024);
+
+    cache.retained = 7;
+    cache.buckets[3] = (Arena *)&cache;
+    arena_cache_init(&cache, 1024);
+    TEST_EQUAL(cache.capacity, 1024);
+    TEST_EQUAL(cache.retained, 0);
+    TEST_NULL(cache.buckets[0]);
+    TEST_NULL(cache.buckets[3]);
+    TEST_NULL(cache.buckets[ARENA_CACHE_BUCKETS - 1]);
+}
+
+
+void test_arena_cache_acquire(void)
+{
+    Arena_Cache cache;
+    Arena *arena;
+    Arena *small;
+    Arena *large;
+
+    arena_cache_init(&cache, 4096);
+    TEST_NULL(arena_cache_acquire(&cache, 0));
+    TEST_NULL(arena_cache_acquire(NULL, 0));
+
+    arena = arena_cache_acquire(NULL, 100);
+    TEST_FATAL(arena != NULL, "Arena was NULL after acquiring without a cache. Fatal.");
+    TEST_EQUAL(arena->size, 100);
+    arena_destroy(arena);
+
+    /* A miss creates a new arena */
+    arena = arena_cache_acquire(&cache, 100);
+    TEST_FATAL(arena != NULL, "Arena was NULL after acquiring from an empty cache. Fatal.");
+    TEST_EQUAL(arena->size, 100);
+
+    /* The same size comes back as the same arena, cleared */
+    arena_alloc(arena, 40);
+    arena_cache_release(&cache, arena);
+    TEST_EQUAL(arena_cache_acquire(&cache, 100), arena);
+    TEST_EQUAL(arena->index, 0);
+    TEST_EQUAL(cache.retained, 0);
+
+    /* Arenas too small for the request are skipped, the next bucket always fits */
+    small = arena_create(80);
+    large = arena_create(200);
+    arena_cache_release(&cache, arena);
+    arena_cache_release(&cache, small);
+    arena_cache_release(&cache, large);
+    TEST_EQUAL(arena_cache_acquire(&cache, 90), arena);
+    TEST_EQUAL(arena_cache_acquire(&cache, 120), large);
+    TEST_EQUAL(cache.retained, 80);
+    TEST_EQUAL(arena_cache_acquire(&cache, 64), small);
+    TEST_EQUAL(cache.retained, 0);
+    arena_destroy(small);
+    arena_destroy(large);
+
+    /* Nothing is handed out from more than one bucket up */
+    large = arena_create(1000);
+    arena_cache_release(&cache, large);
+    small = arena_cache_acquire(&cache, 100);
+    TEST_EQUAL((small == large), 0);
+    TEST_EQUAL(small->size, 100);
+    arena_destroy(small);
+
+    /* Zeroed arenas stay zeroed where the link was kept */
+    arena_keep_zeroed(arena);
+    arena_cache_release(&cache, arena);
+    TEST_EQUAL(arena_cache_acquire(&cache, 100), arena);
+    TEST_EQUAL(arena->region[0], 0);
+    TEST_EQUAL(arena->region[sizeof(Arena *) - 1], 0);
+    arena_destroy(arena);
+
+    arena_cache_flush(&cache);
+}
+
+
+void test_arena_cache_release(void)
+{
+    char buffer[256];
+    Arena_Cache cache;
+    Arena *arena;
+    Arena *inline_arena;
+
+    arena_cache_release(NULL, NULL);
+
+    arena_cache_init(&cache, 300);
+    arena_cache_release(&cache, NULL);
+    TEST_EQUAL(cache.retained, 0);
+
+    arena = arena_create(128);
+    arena_alloc(arena, 64);
+    arena_cache_release(&cache, arena);
+    TEST_EQUAL(cache.buckets[7], arena);
+    TEST_EQUAL(cache.retained, 128);
+    TEST_EQUAL(arena->index, 0);
+
+    inline_arena = arena_create_inline(128);
+    arena_cache_release(&cache, inline_arena);
+    TEST_EQUAL(cache.buckets[7], inline_arena);
+    TEST_EQUAL(cache.retained, 256);
+
+    /* Over capacity, the arena is destroyed instead */
+    arena_cache_release(&cache, arena_create(64));
+    TEST_NULL(cache.buckets[6]);
+    TEST_EQUAL(cache.retained, 256);
+
+    /* Arenas over memory they do not own are never kept */
+    arena_cache_release(&cache, arena_create_from_buffer(buffer, sizeof(buffer)));
+    TEST_EQUAL(cache.retained, 256);
+
+    /* Without a cache the arena is destroyed */
+    arena_cache_release(NULL, arena_create(32));
+
+    TEST_EQUAL(arena_cache_acquire(&cache, 128), inline_arena);
+    TEST_EQUAL(arena_cache_acquire(&cache, 128), arena);
+    arena_destroy(inline_arena);
+    arena_destroy(arena);
+}
+
+
+void test_arena_cache_flush(void)
+{
+    Arena_Cache cache;
+
+    arena_cache_flush(NULL);
+
+    arena_cache_init(&cache, 4096);
+    arena_cache_release(&cache, arena_create(64));
+    arena_cache_release(&cache, arena_create(64));
+    arena_cache_release(&cache, arena_create(1000));
+    TEST_EQUAL(cache.retained, 1128);
+
+    arena_cache_flush(&cache);
+    TEST_EQUAL(cache.retained, 0);
+    TEST_NULL(cache.buckets[6]);
+    TEST_NULL(cache.buckets[9]);
+    TEST_EQUAL(cache.capacity, 4096);
+
+    /* Still usable afterwards */
+    arena_cache_release(&cache, arena_create(64));
+    TEST_EQUAL(cache.retained, 64);
+    arena_cache_flush(&cache);
+}
+
+
+void test_arena_ring_create(void)
+{
+    Arena_Ring *ring;
+
+    TEST_NULL(arena_ring_create(1, 64));
+    TEST_NULL(arena_ring_create(ARENA_RING_MAX + 1, 64));
+    TEST_NULL(arena_ring_create(2, 0));
+
+    ring = arena_ring_create(3, 64);
+    TEST_FATAL(ring != NULL, "Ring was NULL after creation. Fatal.");
+    TEST_EQUAL(ring->count, 3);
+    TEST_EQUAL(ring->current, 0);
+    TEST_EQUAL(ring->epoch, 0);
+    TEST_NOT_NULL(ring->arenas[2]);
+    TEST_EQUAL(ring->arenas[2]->size, 64);
+    TEST_EQUAL((ring->arenas[0] == ring->arenas[1]), 0);
+    arena_ring_destroy(ring);
+}
+
+
+void test_arena_ring_arena(void)
+{
+    Arena_Ring *ring = arena_ring_create(3, 64);
+
+    TEST_NULL(arena_ring_arena(NULL, 0));
+    TEST_NULL(arena_ring_arena(ring, 3));
+
+    TEST_EQUAL(arena_ring_arena(ring, 0), ring->arenas[0]);
+    TEST_EQUAL(arena_ring_arena(ring, 1), ring->arenas[2]);
+    TEST_EQUAL(arena_ring_arena(ring, 2), ring->arenas[1]);
+
+    arena_ring_advance(ring);
+    TEST_EQUAL(arena_ring_arena(ring, 0), ring->arenas[1]);
+    TEST_EQUAL(arena_ring_arena(ring, 1), ring->arenas[0]);
+
+    arena_ring_destroy(ring);
+}
+
+
+void test_arena_ring_alloc(void)
+{
+    Arena_Ring *ring = arena_ring_create(2, 64);
+    char *ptr;
+
+    TEST_NULL(arena_ring_alloc(NULL, 8));
+    TEST_NULL(arena_ring_alloc(ring, 0));
+    TEST_NULL(arena_ring_alloc(ring, 65));
+
+    ptr = arena_ring_alloc(ring, 8);
+    TEST_EQUAL(ptr, ring->arenas[0]->region);
+    TEST_EQUAL(ring->arenas[0]->index, 8);
+    TEST_EQUAL(ring->arenas[1]->index, 0);
+
+    arena_ring_destroy(ring);
+}
+
+
+void test_arena_ring_advance(void)
+{
+    Arena_Ring *ring = arena_ring_create(2, 64);
+    char *first;
+    char *second;
+
+    TEST_NULL(arena_ring_advance(NULL));
+
+    /* Data from the previous epoch survives one advance */
+    first = arena_ring_alloc(ring, 16);
+    memcpy(first, "first batch....", 16);
+    TEST_EQUAL(arena_ring_advance(ring), ring->arenas[1]);
+    TEST_EQUAL(ring->epoch, 1);
+    second = arena_ring_alloc(ring, 16);
+    TEST_EQUAL(second, ring->arenas[1]->region);
+    TEST_ARRAY_EQUAL(first, "first batch....", 16);
+    TEST_EQUAL(arena_ring_arena(ring, 1)->index, 16);
+
+    /* and is cleared by the next */
+    TEST_EQUAL(arena_ring_advance(ring), ring->arenas[0]);
+    TEST_EQUAL(ring->epoch, 2);
+    TEST_EQUAL(ring->arenas[0]->index, 0);
+    TEST_EQUAL(ring->arenas[1]->index, 16);
+    TEST_EQUAL(arena_ring_alloc(ring, 4), first);
+
+    arena_ring_destroy(ring);
+}
+
+
+void test_arena_array_init(void)
+{
+    Arena *arena = arena_create(64);
+    Arena_Array array;
+
+    arena_array_init(NULL, arena, 4, 4);
+
+    arena_array_init(&array, arena, 0, 4);
+    TEST_NULL(array.arena);
+    TEST_NULL(arena_array_append(&array, NULL, 1));
+
+    arena_array_init(&array, arena, sizeof(int), ARENA_ALIGNOF(int));
+    TEST_EQUAL(array.arena, arena);
+    TEST_NULL(array.data);
+    TEST_EQUAL(array.count, 0);
+    TEST_EQUAL(array.capacity, 0);
+    TEST_EQUAL(array.element_size, sizeof(int));
+    TEST_EQUAL(arena->index, 0);
+
+    arena_destroy(arena);
+}
+
+
+void test_arena_array_reserve(void)
+{
+    Arena *arena = arena_create(256);
+    Arena_Array array;
+    char *end;
+
+    arena_array_init(&array, arena, 4, 4);
+    TEST_NULL(arena_array_reserve(NULL, 1));
+    TEST_NULL(arena_array_reserve(&array, 0));
+    TEST_NULL(arena_array_reserve(&array, (size_t)-1 / 2));
+
+    end = arena_array_reserve(&array, 3);
+    TEST_NOT_NULL(end);
+    TEST_EQUAL(end, array.data);
+    TEST_EQUAL(array.capacity, 3);
+    TEST_EQUAL(array.count, 0);
+
+    /* Capacity at least doubles, in place while the array is the tail */
+    array.count = 3;
+    end = arena_array_reserve(&array, 1);
+    TEST_EQUAL(end, array.data + 12);
+    TEST_EQUAL(array.capacity, 6);
+    TEST_EQUAL(arena->index, (size_t)(array.data - arena->region) + 24);
+
+    /* Nothing happens when there is already room */
+    TEST_EQUAL(arena_array_reserve(&array, 3), end);
+    TEST_EQUAL(array.capacity, 6);
+
+    arena_destroy(arena);
+}
+
+
+void test_arena_array_append(void)
+{
+    Arena *arena = arena_create(256);
+    Arena_Array array;
+    int values[4] = {1, 2, 3, 4};
+    int *data;
+    int *moved;
+    char *blocker;
+
+    arena_array_init(&array, arena, sizeof(int), ARENA_ALIGNOF(int));
+    TEST_NULL(arena_array_append(NULL, values, 1));
+    TEST_NULL(arena_array_append(&array, values, 0));
+
+    data = arena_array_append(&array, values, 4);
+    TEST_FATAL(data != NULL, "Array append failed. Fatal.");
+    TEST_EQUAL(array.count, 4);
+    TEST_ARRAY_EQUAL(data, values, 4);
+
+    /* Growing in place keeps every element where it is */
+    TEST_EQUAL(arena_array_append(&array, values, 2), data + 4);
+    TEST_EQUAL(array.count, 6);
+    TEST_EQUAL(array.capacity, 8);
+    TEST_EQUAL((int *)array.data, data);
+
+    /* Elements can be left for the caller to fill in */
+    moved = arena_array_append(&array, NULL, 2);
+    TEST_EQUAL(moved, data + 6);
+    moved[0] = 7;
+    TEST_EQUAL(array.count, 8);
+
+    /* Once something else is allocated, growing moves the array */
+    blocker = arena_alloc(arena, 1);
+    moved = arena_array_append(&array, values, 1);
+    TEST_FATAL(moved != NULL, "Array append after another allocation failed. Fatal.");
+    TEST_EQUAL(((char *)moved > blocker), 1);
+    TEST_EQUAL(((size_t)array.data % ARENA_ALIGNOF(int)), 0);
+    TEST_ARRAY_EQUAL(((int *)array.data), values, 4);
+    TEST_EQUAL(((int *)array.data)[6], 7);
+    TEST_EQUAL(array.capacity, 16);
+
+    arena_destroy(arena);
+}
+
+
+void test_arena_array_freeze(void)
+{
+    Arena *arena = arena_create(256);
+    Arena_Array array;
+    Arena_Slice slice;
+    int values[3] = {5, 6, 7};
+    size_t start;
+
+    slice = arena_array_freeze(NULL);
+    TEST_NULL(slice.data);
+    TEST_EQUAL(slice.count, 0);
+
+    arena_array_init(&array, arena, sizeof(int), ARENA_ALIGNOF(int));
+    slice = arena_array_freeze(&array);
+    TEST_NULL(slice.data);
+
+    arena_array_reserve(&array, 16);
+    arena_array_append(&array, values, 3);
+    start = (size_t)(array.data - arena->region);
+
+    /* The unused capacity goes back to the arena */
+    slice = arena_array_freeze(&array);
+    TEST_EQUAL(slice.count, 3);
+    TEST_EQUAL((char *)slice.data, arena->region + start);
+    TEST_ARRAY_EQUAL(((int *)slice.data), values, 3);
+    TEST_EQUAL(arena->index, start + sizeof(values));
+    TEST_NULL(array.data);
+    TEST_EQUAL(array.count, 0);
+
+    /* Appending afterwards leaves the frozen elements alone */
+    arena_array_append(&array, values + 2, 1);
+    TEST_EQUAL((array.data == (char *)slice.data), 0);
+    TEST_ARRAY_EQUAL(((int *)slice.data), values, 3);
+
+    arena_destroy(arena);
+}
+
+
+void test_arena_string_init(void)
+{
+    Arena *arena = arena_create(64);
+    Arena_String string;
+
+    arena_string_init(NULL, arena);
+
+    arena_string_init(&string, NULL);
+    TEST_NULL(arena_string_append(&string, "a", 1));
+
+    arena_string_init(&string, arena);
+    TEST_EQUAL(string.arena, arena);
+    TEST_NULL(string.data);
+    TEST_EQUAL(string.length, 0);
+    TEST_EQUAL(string.capacity, 0);
+    TEST_EQUAL(arena->index, 0);
+
+    arena_destroy(arena);
+}
+
+
+void test_arena_string_reserve(void)
+{
+    Arena *arena = arena_create(64);
+    Arena_String string;
+    char *end;
+
+    arena_string_init(&string, arena);
+    TEST_NULL(arena_string_reserve(NULL, 4));
+    TEST_NULL(arena_string_reserve(&string, (size_t)-1));
+
+    /* Room is always made for the terminator */
+    end = arena_string_reserve(&string, 0);
+    TEST_EQUAL(end, string.data);
+    TEST_EQUAL(string.capacity, 1);
+
+    end = arena_string_reserve(&string, 4);
+    TEST_EQUAL(end, string.data);
+    TEST_EQUAL(string.capacity, 5);
+    TEST_EQUAL(arena->index, 5);
+
+    TEST_NULL(arena_string_reserve(&string, 64));
+    TEST_EQUAL(string.capacity, 5);
+
+    arena_destroy(arena);
+}
+
+
+void test_arena_string_append(void)
+{
+    Arena *arena = arena_create(128);
+    Arena_String string;
+    char *data;
+
+    arena_string_init(&string, arena);
+    TEST_NULL(arena_string_append(NULL, "a", 1));
+    TEST_NULL(arena_string_append(&string, NULL, 1));
+
+    data = arena_string_append(&string, "Hello", 5);
+    TEST_FATAL(data != NULL, "String append failed. Fatal.");
+    TEST_ARRAY_EQUAL(data, "Hello", 6);
+    TEST_EQUAL(string.length, 5);
+
+    /* Only length chars are taken, and the tail grows in place */
+    TEST_EQUAL(arena_string_append(&string, ", world!!!", 8), data);
+    TEST_ARRAY_EQUAL(data, "Hello, world!", 14);
+    TEST_EQUAL(string.length, 13);
+    TEST_EQUAL(string.capacity, 14);
+
+    /* A failure leaves the string as it was */
+    TEST_NULL(arena_string_append(&string, data, 128));
+    TEST_EQUAL(string.length, 13);
+    TEST_ARRAY_EQUAL(string.data, "Hello, world!", 14);
+
+    arena_destroy(arena);
+}
+
+
+void test_arena_string_appendf(void)
+{
+    Arena *arena = arena_create(128);
+    Arena_String string;
+
+    arena_string_init(&string, arena);
+    TEST_NULL(arena_string_appendf(NULL, "%d", 1));
+    TEST_NULL(arena_string_appendf(&string, NULL));
+
+    TEST_NOT_NULL(arena_string_appendf(&string, "%s=%d", "count", 42));
+    TEST_ARRAY_EQUAL(string.data, "count=42", 9);
+    TEST_EQUAL(string.length, 8);
+
+    /* Short enough for the spare capacity, so it is formatted once */
+    arena_string_reserve(&string, 16);
+    TEST_NOT_NULL(arena_string_appendf(&string, " %c", 'x'));
+    TEST_ARRAY_EQUAL(string.data, "count=42 x", 11);
+
+    TEST_NOT_NULL(arena_string_appendf(&string, ", %05u, %s", 7u, "and a longer tail"));
+    TEST_ARRAY_EQUAL(string.data, "count=42 x, 00007, and a longer tail", 37);
+    TEST_EQUAL(string.length, 36);
+
+    /* A failure leaves the string as it was */
+    TEST_NULL(arena_string_appendf(&string, "%100s", ""));
+    TEST_EQUAL(string.length, 36);
+    TEST_ARRAY_EQUAL(string.data, "count=42 x, 00007, and a longer tail", 37);
+
+    arena_destroy(arena);
+}
+
+
+void test_arena_string_freeze(void)
+{
+    Arena *arena = arena_create(128);
+    Arena_String string;
+    Arena_Slice slice;
+
+    slice = arena_string_freeze(NULL);
+    TEST_NULL(slice.data);
+    TEST_EQUAL(slice.count, 0);
+
+    arena_string_init(&string, arena);
+    arena_string_reserve(&string, 32);
+    arena_string_append(&string, "frozen", 6);
+
+    slice = arena_string_freeze(&string);
+    TEST_EQUAL(slice.count, 6);
+    TEST_ARRAY_EQUAL(((char *)slice.data), "frozen", 7);
+    TEST_EQUAL(arena->index, 7);
+    TEST_NULL(string.data);
+    TEST_EQUAL(string.length, 0);
+
+    arena_string_append(&string, "next", 4);
+    TEST_EQUAL(string.data, arena->region + 7);
+    TEST_ARRAY_EQUAL(((char *)slice.data), "frozen", 7);
+
+    arena_destroy(arena);
+}
+
+
+void test_arena_concurrent_create(void)
+{
+    Arena_Concurrent *arena = arena_concurrent_create(0);
+    TEST_NULL(arena);
+    arena = arena_concurrent_create(64);
+    TEST_FATAL(arena != NULL, "Concurrent arena was NULL after creation. Fatal.");
+    TEST_NOT_NULL(arena->region);
+    TEST_EQUAL(arena->size, 64);
+    TEST_EQUAL(atomic_load(&arena->index), 0);
+    arena_concurrent_destroy(arena);
+}
+
+
+#ifndef __STDC_NO_THREADS__
+
+#define CONCURRENT_THREADS 8
+#define CONCURRENT_ALLOCATIONS 1000
+
+
+static int concurrent_worker(void *arg)
+{
+    Arena_Concurrent *arena = arg;
+    int i;
+
+    for (i = 0; i < CONCURRENT_ALLOCATIONS; i++)
+    {
+        int *value = arena_concurrent_alloc(arena, sizeof(int));
+        if (value == NULL)
+        {
+            return 1;
+        }
+        *value = 1;
+    }
+
+    return 0;
+}
+
+#endif /* !__STDC_NO_THREADS__ */
+
+
+void test_arena_concurrent_alloc(void)
+{
+    Arena_Concurrent *arena = arena_concurrent_create(16);
+
+    TEST_FATAL(arena != NULL, "Concurrent arena was NULL after creation. Fatal.");
+    TEST_NULL(arena_concurrent_alloc(NULL, 4));
+    TEST_NULL(arena_concurrent_alloc(arena, 0));
+    TEST_NULL(arena_concurrent_alloc(arena, 17));
+
+    TEST_EQUAL(arena_concurrent_alloc(arena, 10), arena->region);
+    TEST_EQUAL(arena_concurrent_alloc(arena, 6), arena->region + 10);
+    TEST_NULL(arena_concurrent_alloc(arena, 1));
+    TEST_EQUAL(atomic_load(&arena->index), 16);
+    TEST_NULL(arena_concurrent_alloc(arena, 1));
+    TEST_EQUAL(atomic_load(&arena->index), 16);
+
+    arena_concurrent_destroy(arena);
+
+    /* A failed oversized request must not use up what is left */
+    arena = arena_concurrent_create(1024);
+    TEST_FATAL(arena != NULL, "Concurrent arena was NULL after creation. Fatal.");
+    TEST_EQUAL(arena_concurrent_alloc(arena, 80), arena->region);
+    TEST_NULL(arena_concurrent_alloc(arena, 1024));
+    TEST_EQUAL(atomic_load(&arena->index), 80);
+    TEST_EQUAL(arena_concurrent_alloc(arena, 16), arena->region + 80);
+
+    arena_concurrent_destroy(arena);
+
+    #ifndef __STDC_NO_THREADS__
+    {
+        thrd_t threads[CONCURRENT_THREADS];
+        int results = 0;
+        int *values;
+        int sum = 0;
+        int i;
+
+        arena = arena_concurrent_create(sizeof(int) * CONCURRENT_THREADS * CONCURRENT_ALLOCATIONS);
+        TEST_FATAL(arena != NULL, "Concurrent arena was NULL after creation. Fatal.");
+        memset(arena->region, 0, arena->size);
+
+        for (i = 0; i < CONCURRENT_THREADS; i++)
+        {
+            thrd_create(&threads[i], concurrent_worker, arena);
+        }
+
+        for (i = 0; i < CONCURRENT_THREADS; i++)
+        {
+            int result;
+            thrd_join(threads[i], &result);
+            results += result;
+        }
+
+        /* Every allocation must have landed in its own slot */
+        values = (int *)arena->region;
+        for (i = 0; i < CONCURRENT_THREADS * CONCURRENT_ALLOCATIONS; i++)
+        {
+            sum += values[i];
+        }
+
+        TEST_EQUAL(results, 0);
+        TEST_EQUAL(sum, CONCURRENT_THREADS * CONCURRENT_ALLOCATIONS);
+        TEST_EQUAL(atomic_load(&arena->index), arena->size);
+        TEST_NULL(arena_concurrent_alloc(arena, 1));
+
+        arena_concurrent_destroy(arena);
+    }
+    #endif /* !__STDC_NO_THREADS__ */
+}
+
+
+void test_arena_concurrent_alloc_aligned(void)
+{
+    Arena_Concurrent *arena = arena_concurrent_create(64);
+    char *ptr;
+
+    TEST_FATAL(arena != NULL, "Concurrent arena was NULL after creation. Fatal.");
+    TEST_NULL(arena_concurrent_alloc_aligned(NULL, 4, 4));
+    TEST_NULL(arena_concurrent_alloc_aligned(arena, 0, 4));
+
+    arena_concurrent_alloc_aligned(arena, 3, 0);
+    ptr = arena_concurrent_alloc_aligned(arena, 8, 8);
+    TEST_EQUAL((size_t)ptr % 8, 0);
+    TEST_EQUAL(atomic_load(&arena->index), (size_t)(ptr - arena->region) + 8);
+    TEST_NULL(arena_concurrent_alloc_aligned(arena, 64, 1));
+
+    arena_concurrent_destroy(arena);
+}
+
+
+void test_arena_concurrent_clear(void)
+{
+    Arena_Concurrent *arena = arena_concurrent_create(16);
+    arena_concurrent_alloc(arena, 16);
+    arena_concurrent_clear(arena);
+    TEST_EQUAL(atomic_load(&arena->index), 0);
+    TEST_EQUAL(arena_concurrent_alloc(arena, 16), arena->region);
+    arena_concurrent_clear(NULL);
+    arena_concurrent_destroy(arena);
+}
+
+
+void test_arena_local_init(void)
+{
+    Arena_Concurrent *parent = arena_concurrent_create(256);
+    Arena_Local local;
+
+    arena_local_init(NULL, parent, 64);
+
+    arena_local_init(&local, parent, 0);
+    TEST_NULL(local.parent);
+    TEST_NULL(arena_local_alloc(&local, 8));
+
+    arena_local_init(&local, parent, 64);
+    TEST_EQUAL(local.parent, parent);
+    TEST_NULL(local.region);
+    TEST_EQUAL(local.chunk_size, 64);
+    TEST_EQUAL(atomic_load(&parent->index), 0);
+
+    arena_concurrent_destroy(parent);
+}
+
+
+void test_arena_local_alloc(void)
+{
+    Arena_Concurrent *parent = arena_concurrent_create(256);
+    Arena_Local first;
+    Arena_Local second;
+    char *a;
+    char *b;
+
+    arena_local_init(&first, parent, 64);
+    arena_local_init(&second, parent, 64);
+
+    TEST_NULL(arena_local_alloc(NULL, 8));
+    TEST_NULL(arena_local_alloc(&first, 0));
+
+    a = arena_local_alloc(&first, 8);
+    b = arena_local_alloc(&second, 8);
+    TEST_EQUAL(a, parent->region);
+    TEST_EQUAL(b, parent->region + 64);
+    TEST_EQUAL(arena_local_alloc(&first, 8), a + 8);
+    TEST_EQUAL(atomic_load(&parent->index), 128);
+
+    /* Big allocations skip the chunk */
+    TEST_EQUAL(arena_local_alloc(&first, 50), parent->region + 128);
+    TEST_EQUAL(first.index, 16);
+
+    /* A full chunk is replaced by a fresh one from the parent */
+    arena_local_alloc(&second, 32);
+    TEST_EQUAL(arena_local_alloc(&second, 32), parent->region + 178);
+    TEST_EQUAL(second.region, parent->region + 178);
+
+    /* Clearing the parent resets every local chunk */
+    arena_concurrent_clear(parent);
+    TEST_EQUAL(arena_local_alloc(&second, 8), parent->region);
+    TEST_EQUAL(arena_local_alloc(&first, 8), parent->region + 64);
+
+    arena_concurrent_destroy(parent);
+}
+
+
+void test_arena_local_alloc_aligned(void)
+{
+    Arena_Concurrent *parent = arena_concurrent_create(256);
+    Arena_Local local;
+    char *ptr;
+
+    arena_local_init(&local, parent, 64);
+    arena_local_alloc_aligned(&local, 3, 1);
+    ptr = arena_local_alloc_aligned(&local, 8, 8);
+    TEST_EQUAL((size_t)ptr % 8, 0);
+    TEST_EQUAL(local.index, (size_t)(ptr - local.region) + 8);
+    TEST_NULL(arena_local_alloc_aligned(&local, 0, 8));
+
+    /* Alignments close to the chunk size get a chunk big enough for their padding */
+    local.index = local.size;
+    ptr = arena_local_alloc_aligned(&local, 16, 60);
+    TEST_FATAL(ptr != NULL, "Allocation aligned close to the chunk size was NULL.");
+    TEST_EQUAL((size_t)ptr % 60, 0);
+    TEST_EQUAL((local.size >= 16 + 60 - 1), 1);
+    TEST_EQUAL(local.index, (size_t)(ptr - local.region) + 16);
+
+    arena_concurrent_destroy(parent);
+}
+
+
+void test_arena_nodes_create(void)
+{
+    Arena_Nodes *nodes;
+    int node;
+
+    TEST_NULL(arena_nodes_create(0));
+
+    nodes = arena_nodes_create(256);
+    TEST_FATAL(nodes != NULL, "Per-node arenas could not be created. Fatal.");
+    TEST_EQUAL(nodes->count, arena_node_count());
+    for (node = 0; node < nodes->count; node++)
+    {
+        TEST_NOT_NULL(nodes->arenas[node]);
+        TEST_EQUAL(nodes->arenas[node]->size, 256);
+    }
+
+    arena_nodes_destroy(nodes);
+    arena_nodes_destroy(NULL);
+}
+
+
+void test_arena_nodes_local(void)
+{
+    Arena_Nodes *nodes = arena_nodes_create(256);
+    Arena_Local local;
+
+    TEST_FATAL(nodes != NULL, "Per-node arenas could not be created. Fatal.");
+
+    TEST_NULL(arena_nodes_local(NULL));
+    TEST_EQUAL(arena_nodes_local(nodes), nodes->arenas[arena_current_node() % nodes->count]);
+
+    /* Per-thread caches can sit on top of the caller's node */
+    arena_local_init(&local, arena_nodes_local(nodes), 64);
+    TEST_NOT_NULL(arena_local_alloc(&local, 16));
+
+    arena_nodes_destroy(nodes);
+}
+
+
+void test_arena_nodes_alloc(void)
+{
+    Arena_Nodes *nodes = arena_nodes_create(256);
+    Arena_Concurrent *local;
+    char *ptr;
+
+    TEST_FATAL(nodes != NULL, "Per-node arenas could not be created. Fatal.");
+
+    TEST_NULL(arena_nodes_alloc(NULL, 8));
+    TEST_NULL(arena_nodes_alloc(nodes, 0));
+
+    local = arena_nodes_local(nodes);
+    ptr = arena_nodes_alloc(nodes, 8);
+    TEST_EQUAL(ptr, local->region);
+    TEST_NULL(arena_nodes_alloc(nodes, 512));
+
+    arena_nodes_destroy(nodes);
+}
+
+
+void test_arena_reset_stats(void)
+{
+    Arena *arena = arena_create(32);
+    Arena_Request requests[2];
+
+    arena_reset_stats(NULL);
+
+    TEST_EQUAL(arena->stats.peak, 0);
+    TEST_EQUAL(arena->stats.requested, 0);
+    TEST_EQUAL(arena->stats.padding, 0);
+    TEST_EQUAL(arena->stats.failures, 0);
+    TEST_EQUAL(arena->stats.expansions, 0);
+
+    arena_alloc_aligned(arena, 3, 1);
+    arena_alloc_aligned(arena, 4, 4);
+    TEST_EQUAL(arena->stats.requested, 7);
+    TEST_EQUAL(arena->stats.padding, 1);
+    TEST_EQUAL(arena->stats.peak, 8);
+
+    TEST_NULL(arena_alloc(arena, 64));
+    TEST_EQUAL(arena->stats.failures, 1);
+
+    /* The peak survives a clear */
+    arena_clear(arena);
+    arena_alloc(arena, 2);
+    TEST_EQUAL(arena->stats.peak, 8);
+    TEST_EQUAL(arena->stats.requested, 9);
+
+    requests[0].size = 2;
+    requests[0].alignment = 1;
+    requests[1].size = 8;
+    requests[1].alignment = 8;
+    arena_alloc_batch(arena, requests, 2);
+    TEST_EQUAL(arena->stats.requested, 19);
+    TEST_EQUAL(arena->stats.padding, 5);
+    TEST_EQUAL(arena->stats.peak, 16);
+
+    arena = arena_expand(arena, 64);
+    TEST_FATAL(arena != NULL, "Expanding an arena with stats failed.");
+    TEST_EQUAL(arena->stats.expansions, 1);
+
+    arena_reset_stats(arena);
+    TEST_EQUAL(arena->stats.peak, 0);
+    TEST_EQUAL(arena->stats.requested, 0);
+    TEST_EQUAL(arena->stats.padding, 0);
+    TEST_EQUAL(arena->stats.failures, 0);
+    TEST_EQUAL(arena->stats.expansions, 0);
+    arena_destroy(arena);
+
+    /* Growth that allocations trigger on their own is counted too */
+    arena = arena_create_chained(16, 2);
+    TEST_FATAL(arena != NULL, "Chained arena creation failed!");
+    arena_alloc(arena, 16);
+    arena_alloc(arena, 16);
+    TEST_EQUAL(arena->stats.expansions, 1);
+    arena = arena_expand(arena, 64);
+    TEST_EQUAL(arena->stats.expansions, 2);
+    arena_destroy(arena);
+
+    arena = arena_create_virtual(ARENA_COMMIT_SIZE * 4, 0);
+    TEST_FATAL(arena != NULL, "Virtual arena creation failed!");
+    arena_alloc(arena, arena->size + 1);
+    TEST_EQUAL(arena->stats.expansions, 1);
+    arena_destroy(arena);
+}
+
+
+void test_arena_guard(void)
+{
+    Arena *arena = arena_create(64);
+
+    arena_guard(NULL);
+
+    /* Allocations made before guarding have no canaries to check */
+    arena_alloc(arena, 8);
+    arena_guard(arena);
+    TEST_EQUAL((arena->flags & ARENA_FLAG_GUARD), 0);
+
+    arena_clear(arena);
+    arena_guard(arena);
+    TEST_EQUAL((arena->flags & ARENA_FLAG_GUARD), ARENA_FLAG_GUARD);
+    TEST_EQUAL(arena->index, 0);
+    arena_destroy(arena);
+
+    arena = arena_create_chained(16, 2);
+    arena_add_block(arena, 16);
+    arena_guard(arena);
+    TEST_EQUAL((arena->flags & ARENA_FLAG_GUARD), 0);
+    arena_destroy(arena);
+}
+
+
+void test_arena_guard_alloc(void)
+{
+    Arena *arena = arena_create(64);
+    Arena_Request requests[2];
+    size_t previous;
+    char *first;
+    char *second;
+
+    arena_guard(arena);
+    TEST_NULL(arena_guard_alloc(NULL, 8, 1));
+    TEST_NULL(arena_guard_alloc(arena, 0, 1));
+
+    /* Each allocation is followed by its canary and the end of the one before */
+    first = arena_alloc(arena, 5);
+    TEST_EQUAL(first, arena->region);
+    TEST_EQUAL(arena->index, 5 + ARENA_GUARD_OVERHEAD);
+    TEST_EQUAL((unsigned char)first[5], ARENA_GUARD_BYTE);
+    TEST_EQUAL((unsigned char)first[4 + ARENA_GUARD_SIZE], ARENA_GUARD_BYTE);
+    memcpy(&previous, first + 5 + ARENA_GUARD_SIZE, sizeof(size_t));
+    TEST_EQUAL(previous, 0);
+
+    second = arena_alloc_aligned(arena, 4, 8);
+    TEST_EQUAL(((size_t)second % 8), 0);
+    memcpy(&previous, second + 4 + ARENA_GUARD_SIZE, sizeof(size_t));
+    TEST_EQUAL(previous, 5 + ARENA_GUARD_OVERHEAD);
+
+    /* The canary has to fit as well */
+    TEST_NULL(arena_alloc(arena, arena->size - arena->index));
+    arena_destroy(arena);
+
+    /* Chained arenas grow as usual */
+    arena = arena_create_chained(32, 2);
+    arena_guard(arena);
+    arena_alloc(arena, 8);
+    first = arena_alloc(arena, 24);
+    TEST_NOT_NULL(arena->blocks);
+    TEST_EQUAL(first, arena->region);
+    TEST_NULL(arena_guard_check(arena));
+    arena_destroy(arena);
+
+    /* Batches give every request a canary of its own */
+    arena = arena_create(128);
+    arena_guard(arena);
+    requests[0].size = 6;
+    requests[0].alignment = 0;
+    requests[1].size = 10;
+    requests[1].alignment = 0;
+    TEST_EQUAL(arena_alloc_batch(arena, requests, 2), arena->region);
+    TEST_EQUAL((char *)requests[1].pointer, arena->region + 6 + ARENA_GUARD_OVERHEAD);
+    TEST_EQUAL(arena->index, 16 + ARENA_GUARD_OVERHEAD * 2);
+    requests[1].size = 128;
+    TEST_NULL(arena_alloc_batch(arena, requests, 2));
+    TEST_EQUAL(arena->index, 16 + ARENA_GUARD_OVERHEAD * 2);
+    arena_destroy(arena);
+}
+
+
+void test_arena_guard_check(void)
+{
+    Arena *arena = arena_create(128);
+    char *first;
+    char *second;
+
+    TEST_NULL(arena_guard_check(NULL));
+    first = arena_alloc(arena, 8);
+    first[8] = 0;
+    TEST_NULL(arena_guard_check(arena));
+    arena_destroy(arena);
+
+    arena = arena_create(128);
+    arena_guard(arena);
+    TEST_NULL(arena_guard_check(arena));
+    first = arena_alloc(arena, 8);
+    second = arena_alloc(arena, 8);
+    TEST_NULL(arena_guard_check(arena));
+
+    first[8] = 'x';
+    TEST_EQUAL(arena_guard_check(arena), first + 8);
+    second[9] = 'x';
+    TEST_EQUAL(arena_guard_check(arena), second + 8);
+    first[8] = (char)ARENA_GUARD_BYTE;
+    second[9] = (char)ARENA_GUARD_BYTE;
+
+    /* Clearing and destroying report overruns */
+    guard_failures = 0;
+    arena_clear(arena);
+    TEST_EQUAL(guard_failures, 0);
+    first = arena_alloc(arena, 8);
+    memset(first, 'x', 9);
+    arena_clear(arena);
+    TEST_EQUAL(guard_failures, 1);
+    TEST_EQUAL(guard_pointer, first + 8);
+    first = arena_alloc(arena, 8);
+    first[8] = 'x';
+    arena_destroy(arena);
+    TEST_EQUAL(guard_failures, 2);
+    TEST_EQUAL(guard_pointer, first + 8);
+
+    /* Blocks chained over are checked too */
+    arena = arena_create_chained(32, 1);
+    arena_guard(arena);
+    first = arena_alloc(arena, 8);
+    arena_alloc(arena, 24);
+    TEST_NOT_NULL(arena->blocks);
+    first[8] = 'x';
+    TEST_EQUAL(arena_guard_check(arena), first + 8);
+    first[8] = (char)ARENA_GUARD_BYTE;
+    arena_destroy(arena);
+    TEST_EQUAL(guard_failures, 2);
+}
+
+
+void test_arena_guard_poison(void)
+{
+    Arena *arena = arena_create(64);
+    Arena_Marker marker;
+    char *ptr;
+
+    arena_guard_poison(NULL, 0);
+
+    ptr = arena_alloc(arena, 8);
+    memset(ptr, 1, 8);
+    arena_guard_poison(arena, 0);
+    TEST_EQUAL(ptr[0], 1);
+    arena_destroy(arena);
+
+    arena = arena_create(64);
+    arena_guard(arena);
+    ptr = arena_alloc(arena, 8);
+    memset(ptr, 1, 8);
+    arena_guard_poison(arena, arena->index + 1);
+    TEST_EQUAL(ptr[0], 1);
+
+    /* Released memory is filled, or marked unaddressable under AddressSanitizer */
+    marker = arena_mark(arena);
+    ptr = arena_alloc(arena, 8);
+    memset(ptr, 1, 8);
+    arena_rewind(arena, marker);
+    #ifdef ARENA_ASAN
+    TEST_EQUAL(__asan_address_is_poisoned(ptr), 1);
+    TEST_EQUAL(__asan_address_is_poisoned(arena->region), 0);
+    #else
+    TEST_EQUAL((unsigned char)ptr[0], ARENA_POISON_BYTE);
+    TEST_EQUAL(arena->region[0], 1);
+    #endif /* ARENA_ASAN */
+
+    arena_clear(arena);
+    #ifdef ARENA_ASAN
+    TEST_EQUAL(__asan_address_is_poisoned(arena->region), 1);
+    #else
+    TEST_EQUAL((unsigned char)arena->region[0], ARENA_POISON_BYTE);
+    #endif /* ARENA_ASAN */
+    TEST_NOT_NULL(arena_alloc(arena, 8));
+    arena_destroy(arena);
+
+    /* Arenas kept zeroed are zeroed instead */
+    arena = arena_create(64);
+    arena_keep_zeroed(arena);
+    arena_guard(arena);
+    ptr = arena_alloc(arena, 8);
+    memset(ptr, 1, 8);
+    arena_clear(arena);
+    #ifndef ARENA_ASAN
+    TEST_EQUAL(arena->region[0], 0);
+    #endif /* !ARENA_ASAN */
+    ptr = arena_calloc(arena, 1, 8);
+    TEST_EQUAL(ptr[7], 0);
+    arena_destroy(arena);
+}
+
+
+void test_arena_get_allocation_struct(void)
+{
+    Arena *arena = arena_create(64);
+    char *ptr = arena_alloc(arena, 8);
+    char fake = 'a';
+    Arena_Allocation *allocation_struct = arena_get_allocation_struct(arena, ptr);
+
+    TEST_NULL(arena_get_allocation_struct(NULL, ptr));
+    TEST_NULL(arena_get_allocation_struct(arena, NULL));
+
+    TEST_FATAL(arena != NULL, "Arena was NULL after creation.");
+
+    TEST_FATAL(ptr != NULL, "Pointer was NULL after creation.");
+
+    TEST_FATAL(allocation_struct != NULL, "Allocation struct could not be found through pointer comparison.");
+    TEST_EQUAL(allocation_struct->index, 0);
+    TEST_EQUAL(allocation_struct->size, 8);
+    TEST_NULL(arena_get_allocation_struct(arena, &fake));
+    TEST_NULL(arena_get_allocation_struct(arena, ptr + 1));
+
+    arena_destroy(arena);
+
+    /* Lookups across chunks of allocation structs and chained blocks */
+    {
+        Arena *chained = arena_create_chained(1024, 1);
+        char *pointers[1000];
+        int i;
+
+        for (i = 0; i < 1000; i++)
+        {
+            pointers[i] = arena_alloc(chained, 3);
+        }
+
+        TEST_FATAL(chained->blocks != NULL, "Chained arena did not chain a block.");
+        TEST_EQUAL(chained->allocations, 1000);
+        TEST_EQUAL(arena_get_allocation_struct(chained, pointers[0]), chained->head_allocation);
+        TEST_EQUAL(arena_get_allocation_struct(chained, pointers[341])->pointer, pointers[341]);
+        TEST_EQUAL(arena_get_allocation_struct(chained, pointers[342])->pointer, pointers[342]);
+        TEST_EQUAL(arena_get_allocation_struct(chained, pointers[600])->pointer, pointers[600]);
+        TEST_EQUAL(arena_get_allocation_struct(chained, pointers[999])->pointer, pointers[999]);
+        TEST_EQUAL(arena_get_allocation_struct(chained, pointers[999])->next, NULL);
+
+        arena_destroy(chained);
+    }
+}
+
+
+void test_arena_add_allocation(void)
+{
+    Arena *arena = arena_create(1024);
+
+    arena_alloc(arena, 10);
+    TEST_FATAL(arena->head_allocation != NULL, "Arena head allocation was NULL after first allocation.");
     TEST_EQUAL(arena->head_allocation->size, 10);
     TEST_EQUAL(arena->head_allocation->next, NULL);
     TEST_EQUAL(arena->allocations, 1);
@@ -218,6 +2845,52 @@ void test_arena_add_allocation(void)
     TEST_EQUAL(arena->head_allocation->next->next->next, NULL);
     TEST_EQUAL(arena->allocations, 3);
 
+    /* The list stays linked across chunks of allocation structs */
+    {
+        Arena_Allocation *current = arena->head_allocation;
+        unsigned long count = 0;
+        int i;
+
+        for (i = 0; i < ARENA_ALLOCATION_CHUNK; i++)
+        {
+            arena_alloc(arena, 1);
+        }
+
+        while (current != NULL)
+        {
+            count++;
+            current = current->next;
+        }
+
+        TEST_EQUAL(arena->allocation_chunk_count, 2);
+        TEST_EQUAL(count, arena->allocations);
+    }
+
+    arena_destroy(arena);
+}
+
+
+void test_arena_trim_allocation_list(void)
+{
+    Arena *arena = arena_create(1024);
+
+    arena_trim_allocation_list(NULL, 0);
+
+    arena_alloc(arena, 10);
+    arena_alloc(arena, 15);
+    arena_alloc(arena, 1);
+    arena_trim_allocation_list(arena, 5);
+    TEST_EQUAL(arena->allocations, 3);
+
+    arena_trim_allocation_list(arena, 1);
+    TEST_EQUAL(arena->allocations, 1);
+    TEST_NULL(arena->head_allocation->next);
+    TEST_EQUAL(arena->allocation_chunk_count, 1);
+
+    arena_trim_allocation_list(arena, 0);
+    TEST_EQUAL(arena->allocations, 0);
+    TEST_NULL(arena->head_allocation);
+
     arena_destroy(arena);
 }
 
@@ -239,13 +2912,85 @@ void test_arena_delete_allocation_list(void)
 int main(void)
 {
     SUITE(test_arena_create);
+    SUITE(test_arena_create_chained);
+    SUITE(test_arena_create_inline);
+    SUITE(test_arena_create_from_buffer);
+    SUITE(test_arena_create_virtual);
+    SUITE(test_arena_commit);
+    SUITE(test_arena_decommit);
+    SUITE(test_arena_current_node);
+    SUITE(test_arena_node_count);
+    SUITE(test_arena_bind_memory);
+    SUITE(test_arena_bind_node);
     SUITE(test_arena_expand);
+    SUITE(test_arena_add_block);
+    SUITE(test_arena_pop_block);
+    SUITE(test_arena_set_growth);
+    SUITE(test_arena_reserve);
     SUITE(test_arena_alloc);
     SUITE(test_arena_alloc_aligned);
+    SUITE(test_arena_alloc_simd);
+    SUITE(test_arena_alloc_cache_line);
+    SUITE(test_arena_fixed_alloc);
+    SUITE(test_arena_alloc_grow);
+    SUITE(test_arena_realloc);
+    SUITE(test_arena_realloc_aligned);
+    SUITE(test_arena_calloc);
+    SUITE(test_arena_calloc_aligned);
+    SUITE(test_arena_alloc_batch);
     SUITE(test_arena_copy);
+    SUITE(test_arena_copy_delta);
+    SUITE(test_arena_touch);
+    SUITE(test_arena_fork);
+    SUITE(test_arena_split);
+    SUITE(test_arena_merge);
+    SUITE(test_arena_save);
+    SUITE(test_arena_map);
+    SUITE(test_arena_mark);
+    SUITE(test_arena_rewind);
+    SUITE(test_arena_keep_zeroed);
+    SUITE(test_arena_zero_used);
     SUITE(test_arena_clear);
+    SUITE(test_arena_pool_init);
+    SUITE(test_arena_pool_alloc);
+    SUITE(test_arena_pool_free);
+    SUITE(test_arena_classes_init);
+    SUITE(test_arena_classes_alloc);
+    SUITE(test_arena_cache_init);
+    SUITE(test_arena_cache_acquire);
+    SUITE(test_arena_cache_release);
+    SUITE(test_arena_cache_flush);
+    SUITE(test_arena_ring_create);
+    SUITE(test_arena_ring_arena);
+    SUITE(test_arena_ring_alloc);
+    SUITE(test_arena_ring_advance);
+    SUITE(test_arena_array_init);
+    SUITE(test_arena_array_reserve);
+    SUITE(test_arena_array_append);
+    SUITE(test_arena_array_freeze);
+    SUITE(test_arena_string_init);
+    SUITE(test_arena_string_reserve);
+    SUITE(test_arena_string_append);
+    SUITE(test_arena_string_appendf);
+    SUITE(test_arena_string_freeze);
+    SUITE(test_arena_concurrent_create);
+    SUITE(test_arena_concurrent_alloc);
+    SUITE(test_arena_concurrent_alloc_aligned);
+    SUITE(test_arena_concurrent_clear);
+    SUITE(test_arena_local_init);
+    SUITE(test_arena_local_alloc);
+    SUITE(test_arena_local_alloc_aligned);
+    SUITE(test_arena_nodes_create);
+    SUITE(test_arena_nodes_local);
+    SUITE(test_arena_nodes_alloc);
+    SUITE(test_arena_reset_stats);
+    SUITE(test_arena_guard);
+    SUITE(test_arena_guard_alloc);
+    SUITE(test_arena_guard_check);
+    SUITE(test_arena_guard_poison);
     SUITE(test_arena_get_allocation_struct);
     SUITE(test_arena_add_allocation);
+    SUITE(test_arena_trim_allocation_list);
     SUITE(test_arena_delete_allocation_list);
 
     WRAP_UP();
@@ -0,0 +1,250 @@
+//     Tests for arena.hpp, laid out the same way as test.c. The implementation
+//     of arena.h is compiled separately as C and linked in, the way it has to
+//     be in C++ programs.
+
+#include "test.h"
+#include "arena.hpp"
+
+#include <vector>
+#include <map>
+#include <string>
+
+
+struct Test_Object
+{
+    Test_Object(int a, double b) : a(a), b(b)
+    {
+    }
+
+    int a;
+    alignas(32) double b;
+};
+
+
+void test_arena_alloc_or_throw(void)
+{
+    Arena *arena = arena_create(64);
+    Arena *chained = arena_create_chained(64, 2);
+    bool thrown = false;
+    void *ptr;
+
+    TEST_FATAL(arena != NULL, "Arena creation failed!");
+    TEST_FATAL(chained != NULL, "Chained arena creation failed!");
+
+    ptr = arena_alloc_or_throw(arena, 0, 16);
+    TEST_NOT_NULL(ptr);
+    TEST_EQUAL((reinterpret_cast<std::size_t>(ptr) % 16), 0);
+
+    try
+    {
+        arena_alloc_or_throw(arena, 128, 1);
+    }
+    catch (const std::bad_alloc &)
+    {
+        thrown = true;
+    }
+    TEST_EQUAL(thrown, true);
+    TEST_EQUAL(arena->stats.failures, 1);
+
+    /* Chained arenas grow instead of throwing */
+    ptr = arena_alloc_or_throw(chained, 128, 8);
+    TEST_NOT_NULL(ptr);
+    TEST_NOT_NULL(chained->blocks);
+
+    arena_destroy(arena);
+    arena_destroy(chained);
+}
+
+
+void test_arena_make(void)
+{
+    Arena *arena = arena_create(256);
+    Test_Object *object;
+
+    TEST_FATAL(arena != NULL, "Arena creation failed!");
+
+    arena_alloc(arena, 1);
+    object = arena_make<Test_Object>(arena, 3, 4.5);
+    TEST_NOT_NULL(object);
+    TEST_EQUAL((reinterpret_cast<std::size_t>(object) % alignof(Test_Object)), 0);
+    TEST_EQUAL(object->a, 3);
+    TEST_EQUAL(object->b, 4.5);
+
+    arena->index = arena->size;
+    TEST_NULL(arena_make<Test_Object>(arena, 1, 2.0));
+    TEST_EQUAL(arena->stats.failures, 1);
+
+    arena_destroy(arena);
+}
+
+
+void test_arena_allocator(void)
+{
+    Arena *arena = arena_create(4096);
+    Arena *other = arena_create(64);
+    Arena_Allocator<int> allocator(arena);
+    Arena_Allocator<char> rebound(allocator);
+    size_t before;
+    int i;
+
+    TEST_FATAL(arena != NULL, "Arena creation failed!");
+    TEST_FATAL(other != NULL, "Arena creation failed!");
+
+    TEST_EQUAL(rebound.arena, arena);
+    TEST_EQUAL((allocator == rebound), true);
+    TEST_EQUAL((allocator != Arena_Allocator<int>(other)), true);
+
+    {
+        std::vector<int, Arena_Allocator<int>> vector(allocator);
+        for (i = 0; i < 100; i++)
+        {
+            vector.push_back(i);
+        }
+        TEST_EQUAL(vector[99], 99);
+        TEST_EQUAL((reinterpret_cast<char *>(vector.data()) >= arena->region), true);
+        TEST_EQUAL((reinterpret_cast<char *>(vector.data()) < arena->region + arena->index), true);
+    }
+
+    /* Node based containers rebind the allocator to their nodes */
+    before = arena->index;
+    {
+        typedef std::pair<const int, int> Entry;
+        std::map<int, int, std::less<int>, Arena_Allocator<Entry>> map((Arena_Allocator<Entry>(arena)));
+        map[1] = 2;
+        map[3] = 4;
+        TEST_EQUAL(map[3], 4);
+    }
+    TEST_EQUAL((arena->index > before), true);
+
+    arena_destroy(arena);
+    arena_destroy(other);
+}
+
+
+void test_arena_resource(void)
+{
+#ifdef ARENA_HAS_MEMORY_RESOURCE
+    Arena *arena = arena_create(4096);
+    Arena *other = arena_create(64);
+    Arena_Resource resource(arena);
+    Arena_Resource same(arena);
+    Arena_Resource different(other);
+    bool thrown = false;
+
+    TEST_FATAL(arena != NULL, "Arena creation failed!");
+    TEST_FATAL(other != NULL, "Arena creation failed!");
+
+    TEST_EQUAL((resource == same), true);
+    TEST_EQUAL((resource == different), false);
+    TEST_EQUAL((resource == *std::pmr::new_delete_resource()), false);
+
+    {
+        std::pmr::vector<std::pmr::string> strings(&resource);
+        strings.emplace_back("a string long enough to not fit in the small string buffer");
+        TEST_EQUAL(strings[0].size(), 58);
+        TEST_EQUAL((strings[0].data() >= arena->region), true);
+        TEST_EQUAL((strings[0].data() < arena->region + arena->index), true);
+    }
+
+    TEST_EQUAL((reinterpret_cast<std::size_t>(resource.allocate(8, 64)) % 64), 0);
+
+    try
+    {
+        (void)different.allocate(128, 8);
+    }
+    catch (const std::bad_alloc &)
+    {
+        thrown = true;
+    }
+    TEST_EQUAL(thrown, true);
+
+    arena_destroy(arena);
+    arena_destroy(other);
+#endif /* ARENA_HAS_MEMORY_RESOURCE */
+}
+
+
+void test_arena_fixed(void)
+{
+    Arena_Fixed<128, 64> scratch;
+    Arena_Fixed<64, 16> scratches[3];
+    Test_Object *object;
+    void *ptr;
+    int i;
+
+    TEST_EQUAL((reinterpret_cast<std::size_t>(scratch.region) % 64), 0);
+    TEST_EQUAL(scratch.index, 0);
+
+    ptr = scratch.alloc<3, 1>();
+    TEST_EQUAL(ptr, scratch.region);
+    ptr = scratch.alloc<8, 16>();
+    TEST_EQUAL(ptr, scratch.region + 16);
+    TEST_EQUAL(scratch.index, 24);
+
+    /* Alignments above the arena's fall back to the address */
+    ptr = scratch.alloc(8, 128);
+    TEST_EQUAL((reinterpret_cast<std::size_t>(ptr) % 128), 0);
+    scratch.clear();
+    ptr = scratch.alloc(5, 4);
+    TEST_EQUAL(ptr, scratch.region);
+    TEST_NULL(scratch.alloc(0, 1));
+
+    /* So do alignments that are not powers of two, wherever the region happens to be */
+    for (i = 0; i < 3; i++)
+    {
+        ptr = scratches[i].alloc(6, 3);
+        TEST_EQUAL((reinterpret_cast<std::size_t>(ptr) % 3), 0);
+        ptr = scratches[i].alloc(6, 3);
+        TEST_EQUAL((reinterpret_cast<std::size_t>(ptr) % 3), 0);
+    }
+
+    object = scratch.make<Test_Object>(1, 2.5);
+    TEST_EQUAL(reinterpret_cast<char *>(object), scratch.region + 32);
+    TEST_EQUAL(object->b, 2.5);
+
+    /* Failures leave the index alone */
+    TEST_NULL(scratch.alloc<128>());
+    TEST_NULL(scratch.alloc(100, 1));
+    TEST_EQUAL(scratch.index, 32 + sizeof(Test_Object));
+    TEST_NULL(scratch.make<Test_Object>(3, 4.0));
+}
+
+
+void test_arena_scope(void)
+{
+    Arena *arena = arena_create(256);
+    size_t outer;
+
+    TEST_FATAL(arena != NULL, "Arena creation failed!");
+
+    arena_alloc(arena, 10);
+    {
+        Arena_Scope scope(arena);
+        arena_alloc(arena, 100);
+        outer = arena->index;
+        {
+            Arena_Scope inner(arena);
+            arena_alloc(arena, 50);
+            TEST_EQUAL((arena->index > outer), true);
+        }
+        TEST_EQUAL(arena->index, outer);
+    }
+    TEST_EQUAL(arena->index, 10);
+
+    arena_destroy(arena);
+}
+
+
+int main(void)
+{
+    SUITE(test_arena_alloc_or_throw);
+    SUITE(test_arena_make);
+    SUITE(test_arena_allocator);
+    SUITE(test_arena_resource);
+    SUITE(test_arena_fixed);
+    SUITE(test_arena_scope);
+
+    WRAP_UP();
+
+    return 0;
+}
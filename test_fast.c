@@ -0,0 +1,120 @@
+//     Tests for the allocation hot path as release builds compile it. test.c
+//     always defines ARENA_DEBUG and ARENA_GUARD, which turn the specialised
+//     arena_alloc fast path off, so it is tested here instead, laid out the
+//     same way as test.c. The Makefile builds this file both as it is and with
+//     ARENA_INLINE_HOT_PATH defined.
+
+/* mmap's flags are hidden by strict -std modes without this */
+#define _DEFAULT_SOURCE
+#include "test.h"
+
+
+#define ARENA_IMPLEMENTATION
+#define ARENA_SUPPRESS_MALLOC_WARN
+#include "arena.h"
+
+
+void test_arena_alloc(void)
+{
+    Arena *arena = arena_create(64);
+    char *first;
+    char *ptr;
+
+    TEST_FATAL(arena != NULL, "Arena creation failed!");
+    TEST_NULL(arena_alloc(NULL, 8));
+    TEST_NULL(arena_alloc(arena, 0));
+
+    /* The default alignment is applied even though it is never passed */
+    first = arena_alloc(arena, 1);
+    TEST_EQUAL(first, arena->region + ARENA_ALIGN_PADDING(arena->region, ARENA_DEFAULT_ALIGNMENT));
+    ptr = arena_alloc(arena, 8);
+    TEST_FATAL(ptr != NULL, "Fast path allocation was NULL.");
+    TEST_EQUAL(((size_t)ptr % ARENA_DEFAULT_ALIGNMENT), 0);
+    TEST_EQUAL(ptr, first + ARENA_DEFAULT_ALIGNMENT);
+    TEST_EQUAL(arena->region + arena->index, ptr + 8);
+
+    /* Arenas that cannot grow fail without moving the index */
+    arena->index = arena->size - 4;
+    TEST_NULL(arena_alloc(arena, 8));
+    TEST_EQUAL(arena->index, arena->size - 4);
+    TEST_NULL(arena->blocks);
+    arena_destroy(arena);
+
+    /* Chained arenas fall back to arena_alloc_grow */
+    arena = arena_create_chained(16, 2);
+    TEST_FATAL(arena != NULL, "Chained arena creation failed!");
+    arena_alloc(arena, 16);
+    ptr = arena_alloc(arena, 24);
+    TEST_FATAL(ptr != NULL, "Fast path allocation from a full chained arena was NULL.");
+    TEST_NOT_NULL(arena->blocks);
+    TEST_EQUAL(ptr, arena->region);
+    TEST_EQUAL(arena->index, 24);
+    arena_destroy(arena);
+
+    /* Virtual arenas commit more of their reservation instead */
+    arena = arena_create_virtual(ARENA_COMMIT_SIZE * 4, 0);
+    TEST_FATAL(arena != NULL, "Virtual arena creation failed!");
+    first = arena->region;
+    ptr = arena_alloc(arena, ARENA_COMMIT_SIZE * 2);
+    TEST_EQUAL(ptr, first);
+    TEST_EQUAL((arena->size >= ARENA_COMMIT_SIZE * 2), 1);
+    TEST_NULL(arena->blocks);
+    arena_destroy(arena);
+}
+
+
+void test_arena_alloc_aligned(void)
+{
+    Arena *arena = arena_create(256);
+    char *ptr;
+
+    TEST_FATAL(arena != NULL, "Arena creation failed!");
+    TEST_NULL(arena_alloc_aligned(NULL, 8, 8));
+    TEST_NULL(arena_alloc_aligned(arena, 0, 8));
+
+    arena_alloc_aligned(arena, 1, 1);
+    TEST_EQUAL(arena->index, 1);
+    ptr = arena_alloc_aligned(arena, 8, 64);
+    TEST_EQUAL(((size_t)ptr % 64), 0);
+    ptr = arena_alloc_aligned(arena, 6, 3);
+    TEST_EQUAL(((size_t)ptr % 3), 0);
+    ptr = arena_alloc_aligned(arena, 2, 0);
+    TEST_EQUAL(arena->region + arena->index, ptr + 2);
+
+    arena->index = arena->size - 1;
+    TEST_NULL(arena_alloc_aligned(arena, 1, 64));
+    TEST_EQUAL(arena->index, arena->size - 1);
+
+    arena_destroy(arena);
+}
+
+
+void test_arena_clear(void)
+{
+    Arena *arena = arena_create_chained(16, 1);
+
+    TEST_FATAL(arena != NULL, "Chained arena creation failed!");
+    arena_clear(NULL);
+
+    arena_alloc(arena, 16);
+    arena_alloc(arena, 8);
+    TEST_NOT_NULL(arena->blocks);
+    arena_clear(arena);
+    TEST_NULL(arena->blocks);
+    TEST_EQUAL(arena->index, 0);
+    TEST_EQUAL(arena_alloc(arena, 16), arena->region);
+
+    arena_destroy(arena);
+}
+
+
+int main(void)
+{
+    SUITE(test_arena_alloc);
+    SUITE(test_arena_alloc_aligned);
+    SUITE(test_arena_clear);
+
+    WRAP_UP();
+
+    return 0;
+}